@@ -1,498 +1,1367 @@
-
-
-
-
-
-#ifndef AVLBST_H
-#define AVLBST_H
-
-#include <iostream>
-#include <cstdlib>
-#include <string>
-#include <typeinfo>
-#include "rotateBST.h"
-
-/**
-* A special kind of node for an AVL tree, which adds the height as a data member, plus 
-* other additional helper functions. You do NOT need to implement any functionality or
-* add additional data members or helper functions.
-*/
-template <typename Key, typename Value>
-class AVLNode : public Node<Key, Value>
-{
-public:
-	// Constructor/destructor.
-    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
-    virtual ~AVLNode();
-
-    // Getter/setter for the node's height.
-    int getHeight() const;
-    void setHeight(int height);
-
-    // Getters for parent, left, and right. These need to be redefined since they 
-    // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
-    // for more information.
-    virtual AVLNode<Key, Value>* getParent() const override;
-    virtual AVLNode<Key, Value>* getLeft() const override;
-    virtual AVLNode<Key, Value>* getRight() const override;
-
-protected:
-    int mHeight;
-};
-
-/*
---------------------------------------------
-Begin implementations for the AVLNode class.
---------------------------------------------
-*/
-
-/**
-* Constructor for an AVLNode. Nodes are initialized with a height of 0.
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent)
-    : Node<Key, Value>(key, value, parent)
-    , mHeight(0)
-{
-
-}
-
-/**
-* Destructor.
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>::~AVLNode()
-{
-
-}
-
-/**
-* Getter function for the height. 
-*/
-template<typename Key, typename Value>
-int AVLNode<Key, Value>::getHeight() const
-{
-    return mHeight;
-}
-
-/**
-* Setter function for the height. 
-*/
-template<typename Key, typename Value>
-void AVLNode<Key, Value>::setHeight(int height)
-{
-    mHeight = height;
-}
-
-/**
-* Getter function for the parent. Used since the node inherits from a base node.
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLNode<Key, Value>::getParent() const
-{
-    return static_cast<AVLNode<Key,Value>*>(this->mParent);
-}
-
-/**
-* Getter function for the left child. Used since the node inherits from a base node.
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLNode<Key, Value>::getLeft() const
-{
-    return static_cast<AVLNode<Key,Value>*>(this->mLeft);
-}
-
-/**
-* Getter function for the right child. Used since the node inherits from a base node.
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLNode<Key, Value>::getRight() const
-{
-    return static_cast<AVLNode<Key,Value>*>(this->mRight);
-}
-
-/*
-------------------------------------------
-End implementations for the AVLNode class.
-------------------------------------------
-*/
-
-/**
-* A templated balanced binary search tree implemented as an AVL tree.
-*/
-template <class Key, class Value>
-class AVLTree : public rotateBST<Key, Value>
-{
-public:
-	// Methods for inserting/removing elements from the tree. You must implement
-	// both of these methods. 
-    virtual void insert(const std::pair<Key, Value>& keyValuePair) override;
-    void remove(const Key& key) override;
-
-private:
-    void insertItem(const std::pair<Key, Value>& keyValuePair, AVLNode<Key, Value>* root);
-    void balance();
-    AVLNode<Key, Value>* findPivot(AVLNode<Key, Value>* root);
-    void printHeights(AVLNode<Key, Value>* root);
-    void adjustHeights(AVLNode<Key, Value>* root);
-    void removeTwoChildren(AVLNode<Key, Value>* root);
-    void removeOneChild(AVLNode<Key, Value>* root);
-    void removeZeroChildren(AVLNode<Key, Value>* root);
-    AVLNode<Key, Value>* getLargestNode(AVLNode<Key, Value>* root) const;
-
-};
-
-/*
---------------------------------------------'
-Begin implementations for the AVLTree class.
---------------------------------------------
-*/
-
-/**
-* Insert function for a key value pair. Finds location to insert the node and then balances the tree. 
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::insert(const std::pair<Key, Value>& keyValuePair)
-{
-    // Checks this is the first entry
-    if (this->mRoot == NULL) {
-        this->mRoot = new AVLNode<Key, Value>(keyValuePair.first, keyValuePair.second, NULL); // Create a new AVL Node
-        dynamic_cast<AVLNode<Key,Value>*>(this->mRoot)->setHeight(1);
-    } else {
-        insertItem(keyValuePair, dynamic_cast<AVLNode<Key,Value>*>(this->mRoot));
-    }
-
-    // Adjusting the heights of each node
-    this->adjustHeights(dynamic_cast<AVLNode<Key,Value>*>(this->mRoot));
-
-    // Checking if the tree is balanced after the addition
-    if (!this->isBalanced()) {
-        this->balance();
-    }
-
-}
-
-/**
-* A helper function for insert that runs on recursion with the key value pair. Chooses right location to insert the node
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::insertItem(const std::pair<Key, Value>& keyValuePair, AVLNode<Key, Value>* root) {
-    auto rootKey = (root->getKey());
-    auto itemKey = keyValuePair.first;
-
-    // If the root is greater than the new item, item goes to the left side
-    if (rootKey > itemKey) {
-        if (root->getLeft() == NULL) { // If the left side is empty, create a new Node and place the item
-            root->setLeft(new AVLNode<Key, Value>(keyValuePair.first, keyValuePair.second, root));
-            root->getLeft()->setHeight(1);
-        } else { // If the left child is occupied, keep moving down the left side
-            insertItem(keyValuePair, root->getLeft());
-        }
-    // If the root is less than the new item, tem goes to the right side
-    } else if (rootKey < itemKey) {
-        if (root->getRight() == NULL) { // If the right side is empty, create a new Node and place the item
-            root->setRight(new AVLNode<Key, Value>(keyValuePair.first, keyValuePair.second, root));
-            root->getRight()->setHeight(1);
-        } else { // If the right child is occupied, keep moving down the left side
-            insertItem(keyValuePair, root->getRight());
-        }
-    // If the root equals the item, then overwrite the root's value
-    } else {
-        root->setValue(keyValuePair.second);
-    }
-}
-
-/**
-* A helper function that balances the tree
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::balance() {
-    // Finding the first pivot of the tree
-    auto pivot = this->findPivot(dynamic_cast<AVLNode<Key, Value> *>(this->mRoot));
-
-    // Handling the four types of cases for rotations
-    if (pivot->getRight() != NULL) {
-
-        if (pivot->getRight()->getRight() != NULL) { // If the case is right right
-            this->leftRotate(pivot);
-        } else if (pivot->getRight()->getLeft() != NULL) { // If the case is right left
-            this->rightRotate(pivot->getRight());
-            this->leftRotate(pivot->getRight());
-        }
-
-    } else if (pivot->getLeft() != NULL) {
-        if (pivot->getLeft()->getLeft() != NULL) { // If the case is left left
-            this->rightRotate(pivot);
-        } else if (pivot->getLeft()->getRight() != NULL) { // If the case is left right
-            this->leftRotate(pivot->getLeft());
-            this->rightRotate(pivot);
-        }
-    }
-}
-
-/**
-* A helper function that finds the pivot to balance the tree on
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::findPivot(AVLNode<Key, Value>* root) {
-    int leftHeight;
-    int rightHeight;
-    // Checking of the left node is NULL
-    if (root->getLeft() == NULL) {
-        leftHeight = 0;
-    } else {
-        // Getting the height of the left side
-        leftHeight = root->getLeft()->getHeight();
-    }
-
-    // Checking if the right node is NULL
-    if (root->getRight() == NULL) {
-        rightHeight = 0;
-    } else {
-        // Getting the height of the right side
-        rightHeight = root->getRight()->getHeight();
-    }
-
-    // Creating variables
-    AVLNode<Key, Value>* leftPivot;
-    AVLNode<Key, Value>* rightPivot;
-
-    // Checking if the Node has any left children
-    if (leftHeight > 1) {
-        // Checking if the left side has any pivots
-        leftPivot = findPivot(root->getLeft()); // Recursive
-        // Once we find a pivot, we just keep returning it
-        if (leftPivot != NULL) {
-            // If we find a pivot, we just keep returning it, not looking anymore
-            return leftPivot;
-        }
-    }
-
-    // Checking if the Node has any right children
-    if (rightHeight > 1) {
-        // Checking if the right side has any pivots
-        rightPivot = findPivot(root->getRight()); // Recursive
-        // If we find a pivot, we just keep returning it, not looking anymore
-        if (rightPivot != NULL) {
-            return rightPivot;
-        }
-    }
-
-    // If the balance factor is less than or equal to one, there is no pivot
-    if (abs(rightHeight-leftHeight) <= 1) {
-        return NULL;
-    } else {
-        // Return this as the pivot if the balance factor is too big
-        return root;
-    }
-
-}
-
-/**
-* A helper function that just prints the heights of each node, used for debugging purposes
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::printHeights(AVLNode<Key, Value>* root) {
-        if (root->getLeft() != NULL) {
-            printHeights(root->getLeft());
-        }
-        if (root->getRight() != NULL){
-            printHeights(root->getRight());
-        }
-}
-
-/**
-* A recursive function that adjusts the heights of each node after a value has been removed or inserted
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::adjustHeights(AVLNode<Key, Value>* root) {
-    // If the root is nonexistent, then just get out
-    if (root == NULL) {
-        return;
-    }
-    // Adjust the heights of the left and right side first
-    adjustHeights(root->getLeft());
-    adjustHeights(root->getRight());
-
-    // Based on how many children the node has, we set the height of the node
-    if (root->getRight() == NULL && root->getLeft() == NULL)  {
-        root->setHeight(1); // If it is a leaf node, the height is one
-    // If the node only has one child, add one to the child's height
-    } else if (root->getRight() == NULL) {
-        root->setHeight(root->getLeft()->getHeight() + 1);
-    } else if (root->getLeft() == NULL) {
-        root->setHeight(root->getRight()->getHeight() + 1);
-    // If the node has two children, chose the max between their heights
-    } else {
-        root->setHeight(std::max(root->getRight()->getHeight(), root->getLeft()->getHeight()) + 1);
-    }
-
-}
-
-
-
-/**
-* Remove function for a given key. Finds the node, reattaches pointers, and then balances when finished. 
-*/
-
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::remove(const Key& key)
-{
-    // Finding the Node for the corresponding key
-    auto rootNode = dynamic_cast<AVLNode<Key,Value>*>(this->internalFind(key));
-    if (rootNode == NULL) {
-        return;
-    } else if (rootNode->getRight() != NULL && rootNode->getLeft() != NULL) {
-        removeTwoChildren(rootNode);
-    } else if (rootNode->getRight() != NULL || rootNode->getLeft() != NULL) {
-        removeOneChild(rootNode);
-    } else {
-        removeZeroChildren(rootNode);
-    }
-
-    // If the tree is unbalanced, balance it
-    if (!this->isBalanced()) {
-        this->balance();
-    }
-    // After the tree has been balanced, adjust the heights of the tree
-    adjustHeights(dynamic_cast<AVLNode<Key,Value>*>(this->mRoot));
-
-}
-
-/**
-* A helper function that removes a node if it has two children
- * Same as in Binary Search Tree but with AVLNode instead
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::removeTwoChildren(AVLNode<Key, Value>* root)
-{
-    // Finding the largest value in the left subtree
-    auto largest = getLargestNode(root->getLeft());
-
-    // Creating a new node to with the largest value in the right subtree
-    auto newNode = new AVLNode<Key, Value>(largest->getKey(), largest->getValue(), root->getParent());
-    // Changing the pointers to the children both ways
-    newNode->setLeft(root->getLeft());
-    newNode->setRight(root->getRight());
-    newNode->getLeft()->setParent(newNode);
-    newNode->getRight()->setParent(newNode);
-
-    // Checks if the root has a parent or not
-    if (root->getParent() == NULL) {
-        this->mRoot = newNode;
-    } else {
-        // Checks which child of the parent this new node is going to be, either right or left
-        if ((root->getParent())->getLeft() == root) {
-            root->getParent()->setLeft(newNode);
-        } else {
-            root->getParent()->setRight(newNode);
-        }
-    }
-
-    // Removes the largest value from wherever it was found
-    if (largest->getLeft() != NULL) {
-        removeOneChild(largest);
-    } else {
-        removeZeroChildren(largest);
-    }
-
-    delete root;
-
-}
-
-/**
-* A helper function that removes a node if it has one child
- * Same as in Binary Search Tree but with AVLNode instead
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::removeOneChild(AVLNode<Key, Value>* root)
-{
-    // Checking which side the child is on
-    if (root->getRight() != NULL) {
-        auto right = root->getRight();
-        auto parent = root->getParent();
-
-        // Changing the right child's pointer to point to the parent of the original node
-        right->setParent(parent);
-        // Replacing the original node with it's right child by changing the parent's pointer
-        if (parent->getRight() == root) {
-            parent->setRight(right);
-        } else {
-            parent->setLeft(right);
-        }
-
-        // Checking if the node has a parent
-        if (root->getParent() == NULL) {
-            this->mRoot = right;
-        }
-
-        delete root;
-
-    } else {
-        auto left = root->getLeft();
-        auto parent = root->getParent();
-
-        // Changing the left child's pointer to point to the parent of the original node
-        left->setParent(parent);
-        // Replacing the original node with it's left child by changing the parent's pointer
-        if (parent->getLeft() == root) {
-            parent->setLeft(left);
-        } else {
-            parent->setRight(left);
-        }
-
-        // Checking if the node has a parent
-        if (root->getParent() == NULL) {
-            this->mRoot = left;
-        }
-
-        delete root;
-    }
-}
-
-/**
-* A helper function that removes a node if it has zero children
- * Same as in Binary Search Tree but with AVLNode instead
-*/
-template<typename Key, typename Value>
-void AVLTree<Key, Value>::removeZeroChildren(AVLNode<Key, Value>* root)
-{
-    // If the node has no parent (i.e. only value), then set the base node to NULL
-    if (root->getParent() == NULL) {
-        this->mRoot = NULL;
-    }
-
-    // Checking what side the child is on for the parent, to set to NULL
-    if (root->getParent()->getLeft() == root) {
-        root->getParent()->setLeft(NULL);
-    } else {
-        root->getParent()->setRight(NULL);
-    }
-
-    delete root;
-
-}
-
-/**
-* A helper function to removeTwoChildren that finds the largest Node from a starting Node
- * Same as in Binary Search Tree but with AVLNode instead
-*/
-template<typename Key, typename Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::getLargestNode(AVLNode<Key, Value>* root) const
-{
-    // Keeps moving all the way down until it finds the right-most Node
-    if (root->getRight() != NULL) {
-        return getLargestNode(root->getRight());
-    } else {
-        return root;
-    }
-}
-/*
-------------------------------------------
-End implementations for the AVLTree class.
-------------------------------------------
-*/
-
-
-
-#endif
+
+
+
+
+
+#ifndef AVLBST_H
+#define AVLBST_H
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <future>
+#include <thread>
+#include "rotateBST.h"
+#include "treesnapshot.h"
+
+/**
+* A special kind of node for an AVL tree, which adds the height as a data member, plus 
+* other additional helper functions. The Base is the node it extends, which is a plain Node
+* unless the tree also needs something like the subtree sizes of a SizedNode.
+*/
+template <typename Key, typename Value, typename Base = Node<Key, Value> >
+class AVLNode : public Base
+{
+public:
+	// Constructor/destructor.
+    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value, Base>* parent);
+    template <typename... Args>
+    AVLNode(AVLNode<Key, Value, Base>* parent, Args&&... args);
+    ~AVLNode();
+
+    // Getter/setter for the node's height.
+    int getHeight() const;
+    void setHeight(int height);
+
+    // Getters for parent, left, and right. These hide the ones in Node since they
+    // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
+    // for more information.
+    AVLNode<Key, Value, Base>* getParent() const;
+    AVLNode<Key, Value, Base>* getLeft() const;
+    AVLNode<Key, Value, Base>* getRight() const;
+
+protected:
+    int mHeight;
+};
+
+/*
+--------------------------------------------
+Begin implementations for the AVLNode class.
+--------------------------------------------
+*/
+
+/**
+* Constructor for an AVLNode. Nodes are initialized with a height of 0.
+*/
+template<typename Key, typename Value, typename Base>
+AVLNode<Key, Value, Base>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value, Base>* parent)
+    : Base(key, value, parent)
+    , mHeight(0)
+{
+
+}
+
+/**
+* Constructor for an AVLNode whose item is built in place from the given arguments. Also starts with a height of 0.
+*/
+template<typename Key, typename Value, typename Base>
+template<typename... Args>
+AVLNode<Key, Value, Base>::AVLNode(AVLNode<Key, Value, Base>* parent, Args&&... args)
+    : Base(parent, std::forward<Args>(args)...)
+    , mHeight(0)
+{
+
+}
+
+/**
+* Destructor.
+*/
+template<typename Key, typename Value, typename Base>
+AVLNode<Key, Value, Base>::~AVLNode()
+{
+
+}
+
+/**
+* Getter function for the height. 
+*/
+template<typename Key, typename Value, typename Base>
+int AVLNode<Key, Value, Base>::getHeight() const
+{
+    return mHeight;
+}
+
+/**
+* Setter function for the height. 
+*/
+template<typename Key, typename Value, typename Base>
+void AVLNode<Key, Value, Base>::setHeight(int height)
+{
+    mHeight = height;
+}
+
+/**
+* Getter function for the parent. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value, typename Base>
+AVLNode<Key, Value, Base>* AVLNode<Key, Value, Base>::getParent() const
+{
+    return static_cast<AVLNode<Key, Value, Base>*>(this->mParent);
+}
+
+/**
+* Getter function for the left child. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value, typename Base>
+AVLNode<Key, Value, Base>* AVLNode<Key, Value, Base>::getLeft() const
+{
+    return static_cast<AVLNode<Key, Value, Base>*>(this->mLeft);
+}
+
+/**
+* Getter function for the right child. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value, typename Base>
+AVLNode<Key, Value, Base>* AVLNode<Key, Value, Base>::getRight() const
+{
+    return static_cast<AVLNode<Key, Value, Base>*>(this->mRight);
+}
+
+/*
+------------------------------------------
+End implementations for the AVLNode class.
+------------------------------------------
+*/
+
+/**
+* A templated balanced binary search tree implemented as an AVL tree.
+*/
+template <class Key, class Value, class Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator, typename NodeType = AVLNode<Key, Value> >
+class AVLTree : public rotateBST<Key, Value, Compare, Allocator, NodeType>
+{
+public:
+    AVLTree();
+    explicit AVLTree(const Compare& compare);
+    template <typename InputIterator>
+    AVLTree(InputIterator first, InputIterator last, const Compare& compare = Compare());
+    AVLTree(const AVLTree& other);
+    AVLTree(AVLTree&& other) noexcept;
+    AVLTree& operator=(const AVLTree& other);
+    AVLTree& operator=(AVLTree&& other) noexcept;
+
+    // Replaces the contents of the tree with a range of key value pairs, building a balanced tree directly
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+
+    // Methods for writing the items to a snapshot file and rebuilding the tree from one (see treesnapshot.h)
+    template <typename KeyCodec = SnapshotCodec<Key>, typename ValueCodec = SnapshotCodec<Value> >
+    void save(const std::string& path) const;
+    template <typename KeyCodec = SnapshotCodec<Key>, typename ValueCodec = SnapshotCodec<Value> >
+    void load(const std::string& path);
+
+    // Methods for applying a whole batch of updates with one rebalance per affected subtree
+    template <typename InputIterator>
+    void insertBatch(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    void eraseBatch(InputIterator first, InputIterator last);
+
+    // Methods for cutting a tree apart and putting trees back together in O(log n)
+    void split(const Key& key, AVLTree& right);
+    void join(const std::pair<Key, Value>& middle, AVLTree& right);
+    void join(AVLTree& right);
+
+    // Set operations that merge the Nodes of another tree into this one, leaving the other tree empty
+    void unionWith(AVLTree& other);
+    void intersectWith(AVLTree& other);
+    void differenceWith(AVLTree& other);
+
+	// Methods for inserting/removing elements from the tree. You must implement
+	// both of these methods. 
+    virtual void insert(const std::pair<Key, Value>& keyValuePair) override;
+    void remove(const Key& key) override;
+    using rotateBST<Key, Value, Compare, Allocator, NodeType>::insert;
+
+    // Rebalances the tree perfectly in place, see BinarySearchTree::rebalance()
+    void rebalance() override;
+
+private:
+    NodeType* insertItem(const std::pair<Key, Value>& keyValuePair, NodeType* root);
+    void linkNode(Node<Key, Value>* node, Node<Key, Value>* parent) override;
+    void retraceInsert(NodeType* newNode);
+    int heightOf(NodeType* root) const;
+    int balanceOf(NodeType* root) const;
+    void updateHeight(NodeType* root);
+    NodeType* rebalanceAt(NodeType* root);
+    NodeType* retrace(NodeType* current);
+    NodeType* joinSubtrees(NodeType* left, NodeType* middle, NodeType* right);
+    NodeType* joinSubtrees(NodeType* left, NodeType* right);
+    NodeType* detachLargest(NodeType* root, NodeType*& largest);
+    NodeType* detachChild(NodeType* child);
+    NodeType* splitSubtree(NodeType* root, const Key& key,
+                                      NodeType*& left, NodeType*& right);
+    NodeType* takeNodes(AVLTree& other);
+    Node<Key, Value>* detachRange(const Key& lo, const Key& hi) override;
+    NodeType* unionSubtrees(NodeType* first, NodeType* second, int depth,
+                                       std::vector<NodeType*>& garbage);
+    NodeType* intersectSubtrees(NodeType* first, NodeType* second, int depth,
+                                           std::vector<NodeType*>& garbage);
+    NodeType* differenceSubtrees(NodeType* first, NodeType* second, int depth,
+                                            std::vector<NodeType*>& garbage);
+    void freeGarbage(std::vector<NodeType*>& garbage);
+    NodeType* unionBatch(NodeType* root, const std::vector<std::pair<Key, Value> >& items,
+                                    std::size_t begin, std::size_t end);
+    NodeType* differenceBatch(NodeType* root, const std::vector<Key>& keys,
+                                         std::size_t begin, std::size_t end);
+    void printHeights(NodeType* root);
+    NodeType* removeTwoChildren(NodeType* root);
+    NodeType* removeOneChild(NodeType* root);
+    NodeType* removeZeroChildren(NodeType* root);
+    NodeType* getLargestNode(NodeType* root) const;
+    template <typename InputIterator>
+    void assignRange(InputIterator first, InputIterator last, std::input_iterator_tag);
+    template <typename ForwardIterator>
+    void assignRange(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag);
+    template <typename ForwardIterator>
+    NodeType* buildSubtree(ForwardIterator& next, std::size_t count, NodeType* parent);
+
+    // Set operations only hand both halves of a subtree to separate threads if both trees are at least this tall
+    static const int PARALLEL_HEIGHT = 14;
+
+};
+
+/*
+--------------------------------------------'
+Begin implementations for the AVLTree class.
+--------------------------------------------
+*/
+
+/**
+* Default constructor for an empty AVL Tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>::AVLTree()
+{
+
+}
+
+/**
+* Constructor for an empty AVL Tree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>::AVLTree(const Compare& compare)
+    : rotateBST<Key, Value, Compare, Allocator, NodeType>(compare)
+{
+
+}
+
+/**
+* Constructor that builds the tree from a range of key value pairs. See assign().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+AVLTree<Key, Value, Compare, Allocator, NodeType>::AVLTree(InputIterator first, InputIterator last, const Compare& compare)
+    : rotateBST<Key, Value, Compare, Allocator, NodeType>(compare)
+{
+    assign(first, last);
+}
+
+/**
+* Copy constructor. The Nodes are cloned as they are, heights included, so the copy needs no rebalancing. See
+* BinarySearchTree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>::AVLTree(const AVLTree& other)
+    : rotateBST<Key, Value, Compare, Allocator, NodeType>(other)
+{
+
+}
+
+/**
+* Move constructor, which takes over the other tree's Nodes in O(1).
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>::AVLTree(AVLTree&& other) noexcept
+    : rotateBST<Key, Value, Compare, Allocator, NodeType>(std::move(other))
+{
+
+}
+
+/**
+* Copy assignment, which clones the other tree the same way as the copy constructor.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>& AVLTree<Key, Value, Compare, Allocator, NodeType>::operator=(const AVLTree& other)
+{
+    rotateBST<Key, Value, Compare, Allocator, NodeType>::operator=(other);
+    return *this;
+}
+
+/**
+* Move assignment, which frees this tree's Nodes and takes over the other tree's in O(1).
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+AVLTree<Key, Value, Compare, Allocator, NodeType>& AVLTree<Key, Value, Compare, Allocator, NodeType>::operator=(AVLTree&& other) noexcept
+{
+    rotateBST<Key, Value, Compare, Allocator, NodeType>::operator=(std::move(other));
+    return *this;
+}
+
+/**
+* Replaces the contents of the tree with the pairs in [first, last). If the keys are already strictly increasing
+* the tree is built straight from the range in O(n), with every height and parent pointer set and no rotations.
+* Otherwise the pairs are copied, sorted and deduplicated first, where a later pair wins over an earlier one with
+* the same key just like with repeated inserts.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::assign(InputIterator first, InputIterator last)
+{
+    this->clear();
+    assignRange(first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+/**
+* Writes every item to a snapshot file at path in key order, with the given codecs. Trivially copyable keys and
+* values are stored as raw arrays that MappedSnapshot can search in place. The file only replaces an old snapshot
+* once it is complete.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename KeyCodec, typename ValueCodec>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::save(const std::string& path) const
+{
+    saveSnapshot<KeyCodec, ValueCodec>(path, this->begin(), this->end());
+}
+
+/**
+* Replaces the contents of the tree with a snapshot file written by save() with the same codecs. The file is mapped
+* into memory and, since its items are already in order, the tree is built from them in O(n) by assign(). The tree
+* is left unchanged if the file cannot be read.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename KeyCodec, typename ValueCodec>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::load(const std::string& path)
+{
+    MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec> snapshot(path, this->mCompare);
+    AVLTree<Key, Value, Compare, Allocator, NodeType> loaded(snapshot.begin(), snapshot.end(), this->mCompare);
+    *this = std::move(loaded);
+}
+
+/**
+* A helper function for assign() for single pass ranges, which always have to be copied before sorting.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::assignRange(InputIterator first, InputIterator last, std::input_iterator_tag)
+{
+    std::vector<std::pair<Key, Value> > items(first, last);
+    assignRange(items.begin(), items.end(), std::forward_iterator_tag());
+}
+
+/**
+* A helper function for assign() for ranges that can be read more than once.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename ForwardIterator>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::assignRange(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+{
+    // Checking whether the keys are already strictly increasing, while counting them
+    std::size_t count = 0;
+    bool sorted = true;
+    ForwardIterator previous = first;
+    for (ForwardIterator it = first; it != last; ++it) {
+        if (count != 0 && !this->mCompare(previous->first, it->first)) {
+            sorted = false;
+        }
+        previous = it;
+        count++;
+    }
+
+    if (sorted) {
+        this->mRoot = buildSubtree(first, count, NULL);
+        return;
+    }
+
+    // Sorting a copy, where the last pair for a key wins
+    std::vector<std::pair<Key, Value> > items(first, last);
+    this->sortBatch(items);
+    auto next = items.begin();
+    this->mRoot = buildSubtree(next, items.size(), NULL);
+}
+
+/**
+* A recursive helper function that builds a height balanced subtree out of the next count pairs in sorted order.
+* The left half is built first so that the range is read strictly front to back, and the height of every Node
+* follows from the heights of its children. Returns the root of the subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename ForwardIterator>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::buildSubtree(ForwardIterator& next, std::size_t count, NodeType* parent)
+{
+    if (count == 0) {
+        return NULL;
+    }
+
+    std::size_t leftCount = count / 2;
+    auto left = buildSubtree(next, leftCount, NULL);
+    auto root = this->createNode(next->first, next->second, parent);
+    ++next;
+    auto right = buildSubtree(next, count - leftCount - 1, root);
+
+    root->setLeft(left);
+    if (left != NULL) {
+        left->setParent(root);
+    }
+    root->setRight(right);
+    updateHeight(root);
+    return root;
+}
+
+/**
+* Insert function for a key value pair. Finds location to insert the node and then walks back up the insertion
+* path, updating heights and doing at most one single or double rotation at the lowest unbalanced ancestor.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    // Checks this is the first entry
+    if (this->mRoot == NULL) {
+        auto newNode = this->createNode(keyValuePair.first, keyValuePair.second, NULL); // Create a new AVL Node
+        newNode->setHeight(1);
+        this->mRoot = newNode;
+        return;
+    }
+
+    // If the key was already in the tree only its value changed, so the shape is untouched
+    auto newNode = insertItem(keyValuePair, static_cast<NodeType*>(this->mRoot));
+    if (newNode != NULL) {
+        retraceInsert(newNode);
+    }
+}
+
+/**
+* Links a new Node in where findSlot() said it belongs, for the inserts that build their Node in place, and
+* rebalances the same way insert() does.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::linkNode(Node<Key, Value>* node, Node<Key, Value>* parent)
+{
+    auto newNode = static_cast<NodeType*>(node);
+    newNode->setHeight(1);
+    newNode->setParent(static_cast<NodeType*>(parent));
+    if (parent == NULL) {
+        this->mRoot = newNode;
+        return;
+    }
+    if (this->mCompare(newNode->getKey(), parent->getKey())) {
+        parent->setLeft(newNode);
+    } else {
+        parent->setRight(newNode);
+    }
+    retraceInsert(newNode);
+}
+
+/**
+* A helper function for the inserts that walks back up from a new leaf, updating the sizes and heights and doing
+* at most one single or double rotation at the lowest unbalanced ancestor.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::retraceInsert(NodeType* newNode)
+{
+    // Every ancestor gained a Node, and the sizes have to be right before anything is rotated
+    this->updateSizesUpwards(newNode->getParent());
+
+    // Retrace from the new leaf's parent up towards the root
+    auto current = newNode->getParent();
+    while (current != NULL) {
+        int oldHeight = current->getHeight();
+        updateHeight(current);
+
+        // A rotation after an insert restores the subtree to its height before the insert, so nothing above changes
+        if (abs(balanceOf(current)) > 1) {
+            rebalanceAt(current);
+            return;
+        }
+        // If the height did not change, none of the ancestors can have changed either
+        if (current->getHeight() == oldHeight) {
+            return;
+        }
+        current = current->getParent();
+    }
+}
+
+/**
+* A helper function for insert that walks down from the root with the key value pair. Chooses the right location
+* to insert the node and returns it, or returns NULL if the key already existed and only its value was overwritten.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::insertItem(const std::pair<Key, Value>& keyValuePair, NodeType* root) {
+    while (true) {
+        int order = this->compareKeys(keyValuePair.first, root->getKey());
+
+        // If the root is greater than the new item, item goes to the left side
+        if (order < 0) {
+            if (root->getLeft() == NULL) { // If the left side is empty, create a new Node and place the item
+                root->setLeft(this->createNode(keyValuePair.first, keyValuePair.second, root));
+                root->getLeft()->setHeight(1);
+                return root->getLeft();
+            }
+            root = root->getLeft(); // If the left child is occupied, keep moving down the left side
+        // If the root is less than the new item, item goes to the right side
+        } else if (order > 0) {
+            if (root->getRight() == NULL) { // If the right side is empty, create a new Node and place the item
+                root->setRight(this->createNode(keyValuePair.first, keyValuePair.second, root));
+                root->getRight()->setHeight(1);
+                return root->getRight();
+            }
+            root = root->getRight(); // If the right child is occupied, keep moving down the right side
+        // If the root equals the item, then overwrite the root's value
+        } else {
+            root->setValue(keyValuePair.second);
+            return NULL;
+        }
+    }
+}
+
+/**
+* Returns the stored height of a Node, where an empty subtree has a height of 0
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+int AVLTree<Key, Value, Compare, Allocator, NodeType>::heightOf(NodeType* root) const {
+    if (root == NULL) {
+        return 0;
+    }
+    return root->getHeight();
+}
+
+/**
+* Returns the balance factor of a Node, the height of the right subtree minus the height of the left subtree
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+int AVLTree<Key, Value, Compare, Allocator, NodeType>::balanceOf(NodeType* root) const {
+    return heightOf(root->getRight()) - heightOf(root->getLeft());
+}
+
+/**
+* Recomputes the height of a single Node from the stored heights of its children, along with its subtree size if
+* the Nodes keep one
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::updateHeight(NodeType* root) {
+    root->setHeight(std::max(heightOf(root->getLeft()), heightOf(root->getRight())) + 1);
+    this->updateSize(root);
+}
+
+/**
+* Rebalances the tree with BinarySearchTree::rebalance(), which leaves it perfectly balanced and so still an AVL
+* tree, and then recomputes every height bottom up. The walk follows parent pointers, so it needs no extra space.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::rebalance() {
+    BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rebalance();
+
+    NodeType* current = static_cast<NodeType*>(this->mRoot);
+    NodeType* previous = NULL;
+    while (current != NULL) {
+        NodeType* next;
+        if (previous == current->getParent() && current->getLeft() != NULL) {
+            next = current->getLeft();              // Coming down, go left first
+        } else if (previous != current->getRight() && current->getRight() != NULL) {
+            next = current->getRight();             // Coming down or back up from the left, go right next
+        } else {
+            updateHeight(current);                  // Both children are done
+            next = current->getParent();
+        }
+        previous = current;
+        current = next;
+    }
+}
+
+/**
+* Fixes a Node whose balance factor is off by two with a single or double rotation. Only the heights of the
+* rotated Nodes are updated, and the new root of the subtree is returned.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::rebalanceAt(NodeType* root) {
+    if (balanceOf(root) > 1) {
+        auto right = root->getRight();
+        // If the case is right left, first turn it into right right
+        if (balanceOf(right) < 0) {
+            auto rightLeft = right->getLeft();
+            this->rightRotate(right);
+            updateHeight(right);
+            updateHeight(rightLeft);
+        }
+        this->leftRotate(root);
+    } else {
+        auto left = root->getLeft();
+        // If the case is left right, first turn it into left left
+        if (balanceOf(left) > 0) {
+            auto leftRight = left->getRight();
+            this->leftRotate(left);
+            updateHeight(left);
+            updateHeight(leftRight);
+        }
+        this->rightRotate(root);
+    }
+
+    // The old root is now a child of the new root, so fix it first
+    auto newRoot = root->getParent();
+    updateHeight(root);
+    updateHeight(newRoot);
+    return newRoot;
+}
+
+/**
+* A helper function that just prints the heights of each node, used for debugging purposes
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::printHeights(NodeType* root) {
+        if (root->getLeft() != NULL) {
+            printHeights(root->getLeft());
+        }
+        if (root->getRight() != NULL){
+            printHeights(root->getRight());
+        }
+}
+
+/**
+* Remove function for a given key. Finds the node, reattaches pointers, and then retraces from the parent of the
+* unlinked Node up to the root, rotating every unbalanced ancestor on the way. Stops early once a subtree's height
+* no longer changes.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::remove(const Key& key)
+{
+    // Finding the Node for the corresponding key
+    auto rootNode = static_cast<NodeType*>(this->internalFind(key));
+    NodeType* current;
+    if (rootNode == NULL) {
+        return;
+    } else if (rootNode->getRight() != NULL && rootNode->getLeft() != NULL) {
+        current = removeTwoChildren(rootNode);
+    } else if (rootNode->getRight() != NULL || rootNode->getLeft() != NULL) {
+        current = removeOneChild(rootNode);
+    } else {
+        current = removeZeroChildren(rootNode);
+    }
+
+    // Unlike an insert, a rotation can shorten the subtree, so several ancestors may need fixing
+    this->updateSizesUpwards(current);
+    retrace(current);
+}
+
+/**
+* Walks from a Node up towards the root, updating heights and rotating every unbalanced Node on the way. Stops as
+* soon as a subtree keeps its height. If the walk reaches a Node without a parent, that Node (which may be new
+* after a rotation) is returned as the root, otherwise NULL is returned. This also works on detached subtrees.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::retrace(NodeType* current)
+{
+    while (current != NULL) {
+        int oldHeight = current->getHeight();
+        updateHeight(current);
+        if (abs(balanceOf(current)) > 1) {
+            current = rebalanceAt(current);
+        }
+        if (current->getParent() == NULL) {
+            return current;
+        }
+        // If the subtree kept its height, none of the ancestors can have changed
+        if (current->getHeight() == oldHeight) {
+            return NULL;
+        }
+        current = current->getParent();
+    }
+    return NULL;
+}
+
+/**
+* Inserts every pair in [first, last). The sorted batch is split around the root's key, each half is merged into
+* the matching subtree, and the two results are joined back together with the root. Subtrees that no key of the
+* batch falls into are never visited, parts of the batch that reach an empty subtree become a balanced subtree
+* directly, and every affected subtree is rebalanced once by its join. A later pair wins over an earlier one with
+* the same key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::insertBatch(InputIterator first, InputIterator last)
+{
+    std::vector<std::pair<Key, Value> > items(first, last);
+    this->sortBatch(items);
+
+    // The rotations would otherwise move mRoot around while the tree is taken apart
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = unionBatch(root, items, 0, items.size());
+}
+
+/**
+* Removes every key in [first, last) by splitting the sorted keys around each root in the same way as
+* insertBatch() and joining the surviving subtrees back together.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::eraseBatch(InputIterator first, InputIterator last)
+{
+    std::vector<Key> keys(first, last);
+    this->sortKeys(keys);
+
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = differenceBatch(root, keys, 0, keys.size());
+}
+
+/**
+* A recursive helper function for insertBatch() that merges items[begin, end) into the detached subtree at root
+* and returns the root of the result.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::unionBatch(NodeType* root, const std::vector<std::pair<Key, Value> >& items,
+                                                                std::size_t begin, std::size_t end)
+{
+    if (begin == end) {
+        return root;
+    }
+    if (root == NULL) {
+        auto next = items.begin() + begin;
+        return buildSubtree(next, end - begin, NULL);
+    }
+    // A single key is cheaper to insert the usual way, which only writes to the Nodes whose height changes
+    if (end - begin == 1) {
+        auto newNode = insertItem(items[begin], root);
+        if (newNode == NULL) {
+            return root;
+        }
+        this->updateSizesUpwards(newNode->getParent());
+        auto top = retrace(newNode->getParent());
+        return (top != NULL) ? top : root;
+    }
+
+    // Splitting the batch around the root's key, and overwriting the root's value if its key is in the batch
+    auto split = std::lower_bound(items.begin() + begin, items.begin() + end, root->getKey(),
+                                  [this](const std::pair<Key, Value>& item, const Key& key) { return this->mCompare(item.first, key); });
+    std::size_t middle = split - items.begin();
+    std::size_t rightBegin = middle;
+    if (middle != end && !this->mCompare(root->getKey(), items[middle].first)) {
+        root->setValue(items[middle].second);
+        rightBegin++;
+    }
+
+    auto left = unionBatch(detachChild(root->getLeft()), items, begin, middle);
+    auto right = unionBatch(detachChild(root->getRight()), items, rightBegin, end);
+    return joinSubtrees(left, root, right);
+}
+
+/**
+* A recursive helper function for eraseBatch() that removes keys[begin, end) from the detached subtree at root
+* and returns the root of the result.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::differenceBatch(NodeType* root, const std::vector<Key>& keys,
+                                                                     std::size_t begin, std::size_t end)
+{
+    if (begin == end || root == NULL) {
+        return root;
+    }
+
+    auto split = std::lower_bound(keys.begin() + begin, keys.begin() + end, root->getKey(), this->mCompare);
+    std::size_t middle = split - keys.begin();
+    bool found = (middle != end && !this->mCompare(root->getKey(), keys[middle]));
+
+    auto left = differenceBatch(detachChild(root->getLeft()), keys, begin, middle);
+    auto right = differenceBatch(detachChild(root->getRight()), keys, found ? middle + 1 : middle, end);
+    if (found) {
+        this->destroyNode(root);
+        return joinSubtrees(left, right);
+    }
+    return joinSubtrees(left, root, right);
+}
+
+/**
+* Joins two detached AVL subtrees with a detached middle Node whose key lies between them, in time proportional to
+* the difference of their heights. The middle Node is hung off the spine of the taller subtree where the heights
+* match, and the tree is retraced from there. Returns the root of the result.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::joinSubtrees(NodeType* left, NodeType* middle, NodeType* right)
+{
+    int leftHeight = heightOf(left);
+    int rightHeight = heightOf(right);
+
+    // If the heights are close enough, the middle Node can simply become the root
+    if (abs(leftHeight - rightHeight) <= 1) {
+        middle->setParent(NULL);
+        middle->setLeft(left);
+        middle->setRight(right);
+        if (left != NULL) {
+            left->setParent(middle);
+        }
+        if (right != NULL) {
+            right->setParent(middle);
+        }
+        updateHeight(middle);
+        return middle;
+    }
+
+    NodeType* spine;
+    NodeType* parent = NULL;
+    if (leftHeight > rightHeight) {
+        // Walking down the right side of the left subtree to a Node no more than one taller than the right subtree
+        spine = left;
+        while (heightOf(spine) > rightHeight + 1) {
+            parent = spine;
+            spine = spine->getRight();
+        }
+        middle->setLeft(spine);
+        middle->setRight(right);
+        parent->setRight(middle);
+    } else {
+        // Walking down the left side of the right subtree to a Node no more than one taller than the left subtree
+        spine = right;
+        while (heightOf(spine) > leftHeight + 1) {
+            parent = spine;
+            spine = spine->getLeft();
+        }
+        middle->setLeft(left);
+        middle->setRight(spine);
+        parent->setLeft(middle);
+    }
+    middle->setParent(parent);
+    if (middle->getLeft() != NULL) {
+        middle->getLeft()->setParent(middle);
+    }
+    if (middle->getRight() != NULL) {
+        middle->getRight()->setParent(middle);
+    }
+    updateHeight(middle);
+    this->updateSizesUpwards(parent);
+
+    // The root only changes if the retrace rotates all the way up
+    auto top = retrace(parent);
+    if (top != NULL) {
+        return top;
+    }
+    return (leftHeight > rightHeight) ? left : right;
+}
+
+/**
+* Joins two detached AVL subtrees where every key on the left is smaller than every key on the right, by taking the
+* largest Node out of the left subtree and using it as the middle of a joinSubtrees(). Returns the root of the result.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::joinSubtrees(NodeType* left, NodeType* right)
+{
+    if (left == NULL) {
+        return right;
+    }
+    NodeType* largest;
+    left = detachLargest(left, largest);
+    return joinSubtrees(left, largest, right);
+}
+
+/**
+* Unlinks the largest Node of a detached AVL subtree and returns it through largest. Returns the new root of the
+* rebalanced subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::detachLargest(NodeType* root, NodeType*& largest)
+{
+    largest = getLargestNode(root);
+    auto parent = largest->getParent();
+    auto child = largest->getLeft();
+    if (child != NULL) {
+        child->setParent(parent);
+    }
+    largest->setLeft(NULL);
+    largest->setParent(NULL);
+    if (parent == NULL) {
+        return child;
+    }
+    parent->setRight(child);
+    this->updateSizesUpwards(parent);
+
+    auto top = retrace(parent);
+    return (top != NULL) ? top : root;
+}
+
+/**
+* Cuts a subtree loose from its parent so it can be worked on as a tree of its own. Returns the same Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::detachChild(NodeType* child)
+{
+    if (child == NULL) {
+        return NULL;
+    }
+    auto parent = child->getParent();
+    if (parent->getLeft() == child) {
+        parent->setLeft(NULL);
+    } else {
+        parent->setRight(NULL);
+    }
+    child->setParent(NULL);
+    return child;
+}
+
+/**
+* Splits the tree around a key in O(log n). This tree keeps every key smaller than the given key, and right is
+* replaced by a tree with every key greater than or equal to it. Both trees share this tree's allocator and
+* Compare afterwards.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::split(const Key& key, AVLTree<Key, Value, Compare, Allocator, NodeType>& right)
+{
+    if (&right == this) {
+        return;
+    }
+    right.clear();
+    right.mAlloc = this->mAlloc;
+    right.mCompare = this->mCompare;
+
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    NodeType* left;
+    NodeType* greater;
+    auto found = splitSubtree(root, key, left, greater);
+    if (found != NULL) {
+        greater = joinSubtrees(NULL, found, greater);
+    }
+    this->mRoot = left;
+    right.mRoot = greater;
+}
+
+/**
+* Appends a middle pair and then all of right to this tree in O(log n), leaving right empty. Every key in this
+* tree has to be smaller than the middle key, and every key in right has to be larger.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::join(const std::pair<Key, Value>& middle, AVLTree<Key, Value, Compare, Allocator, NodeType>& right)
+{
+    auto middleNode = this->createNode(middle.first, middle.second, NULL);
+    middleNode->setHeight(1);
+    auto greater = takeNodes(right);
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = joinSubtrees(root, middleNode, greater);
+}
+
+/**
+* Appends all of right to this tree in O(log n), leaving right empty. Every key in this tree has to be smaller
+* than every key in right.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::join(AVLTree<Key, Value, Compare, Allocator, NodeType>& right)
+{
+    if (&right == this) {
+        return;
+    }
+    auto greater = takeNodes(right);
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = joinSubtrees(root, greater);
+}
+
+/**
+* Adds every pair of other to this tree, where other's value wins for a key in both trees, and leaves other empty.
+* Built on split and join, this takes O(m log(n/m + 1)) for trees of sizes m <= n, and large trees are merged
+* with both halves of each split running in parallel.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::unionWith(AVLTree<Key, Value, Compare, Allocator, NodeType>& other)
+{
+    if (&other == this) {
+        return;
+    }
+    std::vector<NodeType*> garbage;
+    auto second = takeNodes(other);
+    auto first = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = unionSubtrees(first, second, this->parallelDepth(), garbage);
+    freeGarbage(garbage);
+}
+
+/**
+* Keeps only the keys of this tree that are also in other, with this tree's values, and leaves other empty.
+* Runs in O(m log(n/m + 1)) like unionWith().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::intersectWith(AVLTree<Key, Value, Compare, Allocator, NodeType>& other)
+{
+    if (&other == this) {
+        return;
+    }
+    std::vector<NodeType*> garbage;
+    auto second = takeNodes(other);
+    auto first = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = intersectSubtrees(first, second, this->parallelDepth(), garbage);
+    freeGarbage(garbage);
+}
+
+/**
+* Removes every key of other from this tree and leaves other empty. Runs in O(m log(n/m + 1)) like unionWith().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::differenceWith(AVLTree<Key, Value, Compare, Allocator, NodeType>& other)
+{
+    if (&other == this) {
+        this->clear();
+        return;
+    }
+    std::vector<NodeType*> garbage;
+    auto second = takeNodes(other);
+    auto first = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    this->mRoot = differenceSubtrees(first, second, this->parallelDepth(), garbage);
+    freeGarbage(garbage);
+}
+
+/**
+* A recursive helper function that splits a detached subtree around a key. The Nodes with smaller and larger keys
+* come back as the balanced subtrees left and right, and the detached Node with the key itself (or NULL) is
+* returned. Each level costs one join, and the join heights telescope, so the split takes O(log n).
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::splitSubtree(NodeType* root, const Key& key,
+                                                                  NodeType*& left, NodeType*& right)
+{
+    if (root == NULL) {
+        left = NULL;
+        right = NULL;
+        return NULL;
+    }
+
+    auto rootLeft = detachChild(root->getLeft());
+    auto rootRight = detachChild(root->getRight());
+    int order = this->compareKeys(key, root->getKey());
+    if (order < 0) {
+        NodeType* middle;
+        auto found = splitSubtree(rootLeft, key, left, middle);
+        right = joinSubtrees(middle, root, rootRight);
+        return found;
+    } else if (order > 0) {
+        NodeType* middle;
+        auto found = splitSubtree(rootRight, key, middle, right);
+        left = joinSubtrees(rootLeft, root, middle);
+        return found;
+    }
+    left = rootLeft;
+    right = rootRight;
+    updateHeight(root);
+    return root;
+}
+
+/**
+* Cuts every Node with lo <= key < hi out of the tree in O(log n) with two splits and a join, and returns them as
+* one detached subtree (or NULL) for eraseRange() and eraseRangeAsync() to free.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, Allocator, NodeType>::detachRange(const Key& lo, const Key& hi)
+{
+    if (!this->mCompare(lo, hi)) {
+        return NULL;
+    }
+    auto root = static_cast<NodeType*>(this->mRoot);
+    this->mRoot = NULL;
+    NodeType* left;
+    NodeType* rest;
+    NodeType* middle;
+    NodeType* right;
+    auto found = splitSubtree(root, lo, left, rest);
+    if (found != NULL) {
+        rest = joinSubtrees(NULL, found, rest);
+    }
+    found = splitSubtree(rest, hi, middle, right);
+    if (found != NULL) {
+        right = joinSubtrees(NULL, found, right);
+    }
+    this->mRoot = joinSubtrees(left, right);
+    return middle;
+}
+
+/**
+* Takes all of the Nodes out of another tree, leaving it empty, and returns the root of those Nodes. The Nodes are
+* moved as they are if this tree's allocator can free them, and otherwise copied into Nodes from this tree's
+* allocator first.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::takeNodes(AVLTree<Key, Value, Compare, Allocator, NodeType>& other)
+{
+    if (!this->mAlloc.absorb(other.mAlloc)) {
+        AVLTree<Key, Value, Compare, Allocator, NodeType> copy(this->mCompare);
+        copy.mAlloc = this->mAlloc;
+        copy.assign(other.begin(), other.end());
+        other.clear();
+        other.mRoot = copy.mRoot;
+        other.mAlloc = this->mAlloc;
+        copy.mRoot = NULL;
+    }
+    auto root = static_cast<NodeType*>(other.mRoot);
+    other.mRoot = NULL;
+    return root;
+}
+
+/**
+* A recursive helper function for unionWith(). The second subtree is split around the root of the first one, and
+* the two halves are merged into the root's children, in parallel if there is depth left and both are large.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::unionSubtrees(NodeType* first, NodeType* second,
+                                                                   int depth, std::vector<NodeType*>& garbage)
+{
+    if (first == NULL) {
+        return second;
+    }
+    if (second == NULL) {
+        return first;
+    }
+
+    NodeType* secondLeft;
+    NodeType* secondRight;
+    auto found = splitSubtree(second, first->getKey(), secondLeft, secondRight);
+    if (found != NULL) {
+        first->setValue(found->getValue());
+        garbage.push_back(found);
+    }
+    auto firstLeft = detachChild(first->getLeft());
+    auto firstRight = detachChild(first->getRight());
+
+    NodeType* left;
+    NodeType* right;
+    if (depth > 0 && heightOf(firstLeft) >= PARALLEL_HEIGHT && heightOf(secondLeft) >= PARALLEL_HEIGHT) {
+        std::vector<NodeType*> leftGarbage;
+        auto leftTask = std::async(std::launch::async, [&]() {
+            return unionSubtrees(firstLeft, secondLeft, depth - 1, leftGarbage);
+        });
+        right = unionSubtrees(firstRight, secondRight, depth - 1, garbage);
+        left = leftTask.get();
+        garbage.insert(garbage.end(), leftGarbage.begin(), leftGarbage.end());
+    } else {
+        left = unionSubtrees(firstLeft, secondLeft, depth, garbage);
+        right = unionSubtrees(firstRight, secondRight, depth, garbage);
+    }
+    return joinSubtrees(left, first, right);
+}
+
+/**
+* A recursive helper function for intersectWith(), split up the same way as unionSubtrees().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::intersectSubtrees(NodeType* first, NodeType* second,
+                                                                       int depth, std::vector<NodeType*>& garbage)
+{
+    // Everything left over on either side is not in the intersection
+    if (first == NULL || second == NULL) {
+        if (first != NULL) {
+            garbage.push_back(first);
+        }
+        if (second != NULL) {
+            garbage.push_back(second);
+        }
+        return NULL;
+    }
+
+    NodeType* secondLeft;
+    NodeType* secondRight;
+    auto found = splitSubtree(second, first->getKey(), secondLeft, secondRight);
+    auto firstLeft = detachChild(first->getLeft());
+    auto firstRight = detachChild(first->getRight());
+
+    NodeType* left;
+    NodeType* right;
+    if (depth > 0 && heightOf(firstLeft) >= PARALLEL_HEIGHT && heightOf(secondLeft) >= PARALLEL_HEIGHT) {
+        std::vector<NodeType*> leftGarbage;
+        auto leftTask = std::async(std::launch::async, [&]() {
+            return intersectSubtrees(firstLeft, secondLeft, depth - 1, leftGarbage);
+        });
+        right = intersectSubtrees(firstRight, secondRight, depth - 1, garbage);
+        left = leftTask.get();
+        garbage.insert(garbage.end(), leftGarbage.begin(), leftGarbage.end());
+    } else {
+        left = intersectSubtrees(firstLeft, secondLeft, depth, garbage);
+        right = intersectSubtrees(firstRight, secondRight, depth, garbage);
+    }
+
+    if (found != NULL) {
+        garbage.push_back(found);
+        return joinSubtrees(left, first, right);
+    }
+    updateHeight(first);
+    garbage.push_back(first);
+    return joinSubtrees(left, right);
+}
+
+/**
+* A recursive helper function for differenceWith(). Here the first subtree is split around the root of the second
+* one, since that root is the key that has to go.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::differenceSubtrees(NodeType* first, NodeType* second,
+                                                                        int depth, std::vector<NodeType*>& garbage)
+{
+    if (first == NULL || second == NULL) {
+        if (second != NULL) {
+            garbage.push_back(second);
+        }
+        return first;
+    }
+
+    NodeType* firstLeft;
+    NodeType* firstRight;
+    auto found = splitSubtree(first, second->getKey(), firstLeft, firstRight);
+    if (found != NULL) {
+        garbage.push_back(found);
+    }
+    auto secondLeft = detachChild(second->getLeft());
+    auto secondRight = detachChild(second->getRight());
+    updateHeight(second);
+    garbage.push_back(second);
+
+    NodeType* left;
+    NodeType* right;
+    if (depth > 0 && heightOf(firstLeft) >= PARALLEL_HEIGHT && heightOf(secondLeft) >= PARALLEL_HEIGHT) {
+        std::vector<NodeType*> leftGarbage;
+        auto leftTask = std::async(std::launch::async, [&]() {
+            return differenceSubtrees(firstLeft, secondLeft, depth - 1, leftGarbage);
+        });
+        right = differenceSubtrees(firstRight, secondRight, depth - 1, garbage);
+        left = leftTask.get();
+        garbage.insert(garbage.end(), leftGarbage.begin(), leftGarbage.end());
+    } else {
+        left = differenceSubtrees(firstLeft, secondLeft, depth, garbage);
+        right = differenceSubtrees(firstRight, secondRight, depth, garbage);
+    }
+    return joinSubtrees(left, right);
+}
+
+/**
+* Frees the detached subtrees collected during a set operation. This happens only once the operation is done, so
+* that the parallel parts of it never touch the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void AVLTree<Key, Value, Compare, Allocator, NodeType>::freeGarbage(std::vector<NodeType*>& garbage)
+{
+    for (auto root : garbage) {
+        this->deleteTree(root);
+    }
+    garbage.clear();
+}
+
+/**
+* A helper function that removes a node if it has two children by relinking its predecessor into its place.
+* Returns the lowest Node whose subtree lost a Node, which is where rebalancing has to start.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::removeTwoChildren(NodeType* root)
+{
+    // Finding the largest value in the left subtree, which has no right child
+    auto largest = getLargestNode(root->getLeft());
+    auto largestParent = largest->getParent();
+
+    // Unlinking the largest Node from its spot, unless it is the root's own left child and simply moves up
+    if (largestParent != root) {
+        largestParent->setRight(largest->getLeft());
+        if (largest->getLeft() != NULL) {
+            largest->getLeft()->setParent(largestParent);
+        }
+        largest->setLeft(root->getLeft());
+        largest->getLeft()->setParent(largest);
+    }
+
+    // Relinking the largest Node into the root's place with the root's height, so nothing is created or copied
+    largest->setRight(root->getRight());
+    largest->getRight()->setParent(largest);
+    largest->setParent(root->getParent());
+    largest->setHeight(root->getHeight());
+    if (root->getParent() == NULL) {
+        this->mRoot = largest;
+    } else if (root->getParent()->getLeft() == root) {
+        root->getParent()->setLeft(largest);
+    } else {
+        root->getParent()->setRight(largest);
+    }
+
+    this->destroyNode(root);
+    return (largestParent != root) ? largestParent : largest;
+}
+
+/**
+* A helper function that removes a node if it has one child. Returns the parent of the removed Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::removeOneChild(NodeType* root)
+{
+    // Checking which side the child is on
+    auto child = (root->getRight() != NULL) ? root->getRight() : root->getLeft();
+    auto parent = root->getParent();
+
+    // Changing the child's pointer to point to the parent of the original node
+    child->setParent(parent);
+    // Replacing the original node with it's child by changing the parent's pointer
+    if (parent == NULL) {
+        this->mRoot = child;
+    } else if (parent->getLeft() == root) {
+        parent->setLeft(child);
+    } else {
+        parent->setRight(child);
+    }
+
+    this->destroyNode(root);
+    return parent;
+}
+
+/**
+* A helper function that removes a node if it has zero children. Returns the parent of the removed Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::removeZeroChildren(NodeType* root)
+{
+    auto parent = root->getParent();
+
+    // If the node has no parent (i.e. only value), then set the base node to NULL
+    if (parent == NULL) {
+        this->mRoot = NULL;
+    // Checking what side the child is on for the parent, to set to NULL
+    } else if (parent->getLeft() == root) {
+        parent->setLeft(NULL);
+    } else {
+        parent->setRight(NULL);
+    }
+
+    this->destroyNode(root);
+    return parent;
+}
+
+/**
+* A helper function to removeTwoChildren that finds the largest Node from a starting Node
+ * Same as in Binary Search Tree but with AVLNode instead
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* AVLTree<Key, Value, Compare, Allocator, NodeType>::getLargestNode(NodeType* root) const
+{
+    // Keeps moving all the way down until it finds the right-most Node
+    while (root->getRight() != NULL) {
+        root = root->getRight();
+    }
+    return root;
+}
+/*
+------------------------------------------
+End implementations for the AVLTree class.
+------------------------------------------
+*/
+
+/**
+* An AVL tree that keeps subtree sizes for size(), select() and rank().
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>, template <typename> class Allocator = NodeAllocator>
+using OrderStatisticsAVLTree = AVLTree<Key, Value, Compare, Allocator, AVLNode<Key, Value, SizedNode<Key, Value> > >;
+
+
+
+#endif
@@ -0,0 +1,107 @@
+//
+// Benchmark of BTree against AVLTree and std::map: random inserts, random finds, a full in-order scan and removing
+// half of the keys. Build from the repo root with
+//     g++ -std=c++17 -O2 -I. bench/btree_bench.cpp -o btree_bench
+// and run as ./btree_bench [items], where items defaults to 2000000.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include "btree.h"
+#include "avlbst.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+* Gives std::map the insert() and remove() of the trees, where insert() overwrites the value of an existing key.
+*/
+template <typename Key, typename Value>
+class StdMap : public std::map<Key, Value>
+{
+public:
+    void insert(const std::pair<Key, Value>& keyValuePair)
+    {
+        this->insert_or_assign(keyValuePair.first, keyValuePair.second);
+    }
+
+    void remove(const Key& key)
+    {
+        this->erase(key);
+    }
+};
+
+/**
+* Returns the milliseconds between two points in time.
+*/
+double millisecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+* Times each phase on one container and prints a row of the results. The sums are printed too, so that the
+* compiler cannot drop the finds and the scan.
+*/
+template <typename Tree>
+void run(const char* name, const std::vector<int>& keys, const std::vector<int>& queries)
+{
+    Tree tree;
+    Clock::time_point start = Clock::now();
+    for (int key : keys) {
+        tree.insert(std::make_pair(key, key));
+    }
+
+    Clock::time_point inserted = Clock::now();
+    long found = 0;
+    for (int query : queries) {
+        auto it = tree.find(query);
+        if (it != tree.end()) {
+            found += it->second;
+        }
+    }
+
+    Clock::time_point searched = Clock::now();
+    long scanned = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        scanned += it->first;
+    }
+
+    Clock::time_point scannedAll = Clock::now();
+    for (std::size_t i = 0; i < keys.size(); i += 2) {
+        tree.remove(keys[i]);
+    }
+    Clock::time_point removed = Clock::now();
+
+    std::printf("%-9s %8.0f %8.0f %8.0f %12.0f   (%ld %ld)\n", name, millisecondsBetween(start, inserted),
+                millisecondsBetween(inserted, searched), millisecondsBetween(searched, scannedAll),
+                millisecondsBetween(scannedAll, removed), found % 1000, scanned % 1000);
+}
+
+int main(int argc, char* argv[])
+{
+    const int items = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    std::mt19937 random(1);
+
+    // Every third number, so that about two thirds of the finds miss
+    std::vector<int> keys(items);
+    for (int i = 0; i < items; i++) {
+        keys[i] = i * 3;
+    }
+    std::shuffle(keys.begin(), keys.end(), random);
+    std::vector<int> queries(items);
+    for (int& query : queries) {
+        query = random() % (3 * items);
+    }
+
+    std::printf("%d random int keys, times in ms\n", items);
+    std::printf("%-9s %8s %8s %8s %12s\n", "", "insert", "find", "scan", "remove half");
+    run<BTree<int, int> >("BTree", keys, queries);
+    run<AVLTree<int, int> >("AVLTree", keys, queries);
+    run<StdMap<int, int> >("std::map", keys, queries);
+    return 0;
+}
@@ -0,0 +1,124 @@
+//
+// Throughput of ConcurrentAVLTree against an AVLTree behind one mutex, from 1 to 64 threads, on a 70/30 read/write
+// mix: 70% find(), 20% insert() and 10% remove() of random keys, half of which are in the tree to begin with. Build
+// from the repo root with
+//     g++ -std=c++17 -O2 -pthread -I. bench/concurrentavl_bench.cpp -o concurrentavl_bench
+// and run as ./concurrentavl_bench [operations], where operations defaults to 4000000 per thread count. Threads
+// beyond the number of cores only measure oversubscription, so the numbers only show scaling on a multi core
+// machine.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "concurrentavl.h"
+
+// Keys are drawn from [0, KEY_RANGE), and every other one is loaded before the clock starts
+const int KEY_RANGE = 1 << 20;
+
+// Keeps the results of find() alive, so that the compiler cannot drop the searches
+std::atomic<long> sink(0);
+
+/**
+* Runs work(thread, threads) on the given number of threads and returns the seconds it took.
+*/
+template <typename Work>
+double timeThreads(int threads, Work work)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; thread++) {
+        workers.emplace_back(work, thread, threads);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+* One thread's share of the operations on the ConcurrentAVLTree.
+*/
+void concurrentWork(ConcurrentAVLTree<int, int>& tree, int operations, int thread)
+{
+    std::mt19937 random(thread);
+    long found = 0;
+    for (int operation = 0; operation < operations; operation++) {
+        int key = random() % KEY_RANGE;
+        unsigned choice = random() % 10;
+        int value;
+        if (choice < 7) {
+            found += tree.find(key, value);
+        } else if (choice < 9) {
+            tree.insert(std::make_pair(key, operation));
+        } else {
+            tree.remove(key);
+        }
+    }
+    sink += found;
+}
+
+/**
+* One thread's share of the operations on the AVLTree, each taking the one lock.
+*/
+void lockedWork(AVLTree<int, int>& tree, std::mutex& lock, int operations, int thread)
+{
+    std::mt19937 random(thread);
+    long found = 0;
+    for (int operation = 0; operation < operations; operation++) {
+        int key = random() % KEY_RANGE;
+        unsigned choice = random() % 10;
+        std::lock_guard<std::mutex> guard(lock);
+        if (choice < 7) {
+            found += tree.find(key) != tree.end();
+        } else if (choice < 9) {
+            tree.insert(std::make_pair(key, operation));
+        } else {
+            tree.remove(key);
+        }
+    }
+    sink += found;
+}
+
+int main(int argc, char* argv[])
+{
+    const int operations = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    std::printf("%u cores, %d operations per run, 70%% find / 20%% insert / 10%% remove\n",
+                std::thread::hardware_concurrency(), operations);
+    std::printf("%8s %16s %10s %16s %10s\n", "threads", "concurrent Mop/s", "speedup", "locked Mop/s", "speedup");
+
+    double concurrentBase = 0;
+    double lockedBase = 0;
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        ConcurrentAVLTree<int, int> concurrent;
+        AVLTree<int, int> locked;
+        std::mutex lock;
+        for (int key = 0; key < KEY_RANGE; key += 2) {
+            concurrent.insert(std::make_pair(key, key));
+            locked.insert(std::make_pair(key, key));
+        }
+
+        int share = operations / threads;
+        double concurrentSeconds = timeThreads(threads, [&](int thread, int) {
+            concurrentWork(concurrent, share, thread);
+        });
+        double lockedSeconds = timeThreads(threads, [&](int thread, int) {
+            lockedWork(locked, lock, share, thread);
+        });
+
+        double concurrentRate = share * threads / concurrentSeconds / 1e6;
+        double lockedRate = share * threads / lockedSeconds / 1e6;
+        if (threads == 1) {
+            concurrentBase = concurrentRate;
+            lockedBase = lockedRate;
+        }
+        std::printf("%8d %16.2f %9.2fx %16.2f %9.2fx\n", threads, concurrentRate, concurrentRate / concurrentBase,
+                    lockedRate, lockedRate / lockedBase);
+    }
+    return sink == -1;
+}
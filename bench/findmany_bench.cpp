@@ -0,0 +1,87 @@
+//
+// Benchmark of findMany() against a loop of find(), looking up random keys in an AVLTree built in random order,
+// about half of which are in the tree. Build from the repo root with
+//     g++ -std=c++17 -O2 -I. bench/findmany_bench.cpp -o findmany_bench
+// and run as ./findmany_bench [items] [lookups], which default to 4000000 each. The tree has to be much larger
+// than the caches for the prefetching to pay off.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "avlbst.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef AVLTree<int, int> Tree;
+
+/**
+* Returns the milliseconds between two points in time.
+*/
+double millisecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+* Adds up the values that were found, so that the compiler cannot drop the lookups and the two ways of looking up
+* can be checked against each other.
+*/
+long sumOf(const Tree& tree, const std::vector<Tree::iterator>& results)
+{
+    long sum = 0;
+    for (const Tree::iterator& result : results) {
+        if (result != tree.end()) {
+            sum += result->second;
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[])
+{
+    const int items = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    const int lookups = argc > 2 ? std::atoi(argv[2]) : 4000000;
+    std::mt19937 random(1);
+
+    // Even keys only, inserted in random order so that the Nodes are scattered over the heap
+    std::vector<int> keys(items);
+    for (int i = 0; i < items; i++) {
+        keys[i] = i * 2;
+    }
+    std::shuffle(keys.begin(), keys.end(), random);
+    Tree tree;
+    for (int key : keys) {
+        tree.insert(std::make_pair(key, key));
+    }
+    std::vector<int> queries(lookups);
+    for (int& query : queries) {
+        query = random() % (2 * items);
+    }
+
+    std::vector<Tree::iterator> looped(lookups);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < lookups; i++) {
+        looped[i] = tree.find(queries[i]);
+    }
+    Clock::time_point found = Clock::now();
+
+    std::vector<Tree::iterator> batched(lookups);
+    tree.findMany(queries.begin(), queries.end(), batched.begin());
+    Clock::time_point foundMany = Clock::now();
+
+    long loopedSum = sumOf(tree, looped);
+    long batchedSum = sumOf(tree, batched);
+    double loopTime = millisecondsBetween(start, found);
+    double batchTime = millisecondsBetween(found, foundMany);
+    std::printf("%d keys, %d random lookups\n", items, lookups);
+    std::printf("find() loop %8.0f ms\n", loopTime);
+    std::printf("findMany()  %8.0f ms   %.2fx\n", batchTime, loopTime / batchTime);
+    if (loopedSum != batchedSum) {
+        std::printf("the results differ\n");
+        return 1;
+    }
+    return 0;
+}
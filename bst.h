@@ -1,786 +1,2441 @@
-
-
-
-
-
-#ifndef BST_H
-#define BST_H
-
-#include <iostream>
-#include <exception>
-#include <cstdlib>
-#include <utility>
-
-/**
-* A templated class for a Node in a search tree. The getters for parent/left/right are virtual so that they
-* can be overridden for future kinds of search trees, such as Red Black trees, Splay trees, and AVL trees.
-*/
-template <typename Key, typename Value>
-class Node
-{
-public:
-    Node(const Key& key, const Value& value, Node<Key, Value>* parent);
-    virtual ~Node();
-
-    const std::pair<Key, Value>& getItem() const;
-    std::pair<Key, Value>& getItem();
-    const Key& getKey() const;
-    const Value& getValue() const;
-    Key& getKey();
-    Value& getValue();
-
-    virtual Node<Key, Value>* getParent() const;
-    virtual Node<Key, Value>* getLeft() const;
-    virtual Node<Key, Value>* getRight() const;
-
-    void setParent(Node<Key, Value>* parent);
-    void setLeft(Node<Key, Value>* left);
-    void setRight(Node<Key, Value>* right);
-    void setValue(const Value &value);
-
-protected:
-    std::pair<Key, Value> mItem;
-    Node<Key, Value>* mParent;
-    Node<Key, Value>* mLeft;
-    Node<Key, Value>* mRight;
-};
-
-/*
-	-----------------------------------------
-	Begin implementations for the Node class.
-	-----------------------------------------
-*/
-
-/**
-* Explicit constructor for a node.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent)
-        : mItem(key, value)
-        , mParent(parent)
-        , mLeft(NULL)
-        , mRight(NULL)
-{
-
-}
-
-/**
-* Destructor, which does not need to do anything since the pointers inside of a node
-* are only used as references to existing nodes. The nodes pointed to by parent/left/right
-* are freed within the deleteAll() helper method in the BinarySearchTree.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>::~Node()
-{
-
-}
-
-/**
-* A const getter for the item.
-*/
-template<typename Key, typename Value>
-const std::pair<Key, Value>& Node<Key, Value>::getItem() const
-{
-    return mItem;
-}
-
-/**
-* A non-const getter for the item.
-*/
-template<typename Key, typename Value>
-std::pair<Key, Value>& Node<Key, Value>::getItem()
-{
-    return mItem;
-}
-
-/**
-* A const getter for the key.
-*/
-template<typename Key, typename Value>
-const Key& Node<Key, Value>::getKey() const
-{
-    return mItem.first;
-}
-
-/**
-* A const getter for the value.
-*/
-template<typename Key, typename Value>
-const Value& Node<Key, Value>::getValue() const
-{
-    return mItem.second;
-}
-
-/**
-* A non-const getter for the key.
-*/
-template<typename Key, typename Value>
-Key& Node<Key, Value>::getKey()
-{
-    return mItem.first;
-}
-
-/**
-* A non-const getter for the value.
-*/
-template<typename Key, typename Value>
-Value& Node<Key, Value>::getValue()
-{
-    return mItem.second;
-}
-
-/**
-* An implementation of the virtual function for retreiving the parent.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getParent() const
-{
-    return mParent;
-}
-
-/**
-* An implementation of the virtual function for retreiving the left child.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getLeft() const
-{
-    return mLeft;
-}
-
-/**
-* An implementation of the virtual function for retreiving the right child.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getRight() const
-{
-    return mRight;
-}
-
-/**
-* A setter for setting the parent of a node.
-*/
-template<typename Key, typename Value>
-void Node<Key, Value>::setParent(Node<Key, Value>* parent)
-{
-    mParent = parent;
-}
-
-/**
-* A setter for setting the left child of a node.
-*/
-template<typename Key, typename Value>
-void Node<Key, Value>::setLeft(Node<Key, Value>* left)
-{
-    mLeft = left;
-}
-
-/**
-* A setter for setting the right child of a node.
-*/
-template<typename Key, typename Value>
-void Node<Key, Value>::setRight(Node<Key, Value>* right)
-{
-    mRight = right;
-}
-
-/**
-* A setter for the value of a node.
-*/
-template<typename Key, typename Value>
-void Node<Key, Value>::setValue(const Value& value)
-{
-    mItem.second = value;
-}
-
-/*
-	---------------------------------------
-	End implementations for the Node class.
-	---------------------------------------
-*/
-
-/**
-* A templated unbalanced binary search tree.
-*/
-template <typename Key, typename Value>
-class BinarySearchTree
-{
-public:
-    BinarySearchTree();
-    virtual ~BinarySearchTree();
-    virtual void insert(const std::pair<Key, Value>& keyValuePair);
-    virtual void remove(const Key& key);
-    void clear();
-    void print() const;
-    bool isBalanced() const;
-
-private:
-    void insertItem(const std::pair<Key, Value>& keyValuePair, Node<Key,Value>* root);
-    Node<Key, Value>* getLargestNode(Node<Key, Value>* root) const;
-    void removeTwoChildren(Node<Key,Value>* root);
-    void removeOneChild(Node<Key,Value>* root);
-    void removeZeroChildren(Node<Key,Value>* root);
-    Node<Key, Value>* insidefind(const Key& key, Node<Key, Value>* root) const;
-    void deleteTree(Node<Key, Value>* root);
-    int getHeight(Node<Key, Value>* root) const;
-    bool balanceFactor(Node<Key, Value>* root) const;
-
-public:
-    /**
-    * An internal iterator class for traversing the contents of the BST.
-    */
-    class iterator
-    {
-    public:
-        iterator(Node<Key,Value>* ptr);
-        iterator();
-
-        std::pair<Key,Value>& operator*() const;
-        std::pair<Key,Value>* operator->() const;
-
-        bool operator==(const iterator& rhs) const;
-        bool operator!=(const iterator& rhs) const;
-        iterator& operator=(const iterator& rhs);
-
-        iterator& operator++();
-
-    protected:
-        Node<Key, Value>* mCurrent;
-
-        friend class BinarySearchTree<Key, Value>;
-    };
-
-public:
-    iterator begin() const;
-    iterator end() const;
-    iterator find(const Key& key) const;
-
-protected:
-    Node<Key, Value>* internalFind(const Key& key) const; //TODO
-    Node<Key, Value>* getSmallestNode() const; //TODO
-    void printRoot (Node<Key, Value>* root) const;
-
-protected:
-    Node<Key, Value>* mRoot;
-
-public:
-    void print() {this->printRoot(this->mRoot);}
-
-};
-
-/*
-	---------------------------------------------------------------
-	Begin implementations for the BinarySearchTree::iterator class.
-	---------------------------------------------------------------
-*/
-
-/**
-* Explicit constructor that initializes an iterator with a given node pointer.
-*/
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value>* ptr)
-        : mCurrent(ptr)
-{
-
-}
-
-/**
-* A default constructor that initializes the iterator to NULL.
-*/
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::iterator::iterator()
-        : mCurrent(NULL)
-{
-
-}
-
-/**
-* Provides access to the item.
-*/
-template<typename Key, typename Value>
-std::pair<Key, Value>& BinarySearchTree<Key, Value>::iterator::operator*() const
-{
-    return mCurrent->getItem();
-}
-
-/**
-* Provides access to the address of the item.
-*/
-template<typename Key, typename Value>
-std::pair<Key, Value>* BinarySearchTree<Key, Value>::iterator::operator->() const
-{
-    return &(mCurrent->getItem());
-}
-
-/**
-* Checks if 'this' iterator's internals have the same value
-* as 'rhs'
-*/
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::iterator::operator==(const BinarySearchTree<Key, Value>::iterator& rhs) const
-{
-    return this->mCurrent == rhs.mCurrent;
-}
-
-/**
-* Checks if 'this' iterator's internals have a different value
-* as 'rhs'
-*/
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::iterator::operator!=(const BinarySearchTree<Key, Value>::iterator& rhs) const
-{
-    return this->mCurrent != rhs.mCurrent;
-}
-
-/**
-* Sets one iterator equal to another iterator.
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator &BinarySearchTree<Key, Value>::iterator::operator=(const BinarySearchTree<Key, Value>::iterator& rhs)
-{
-    this->mCurrent = rhs.mCurrent;
-    return *this;
-}
-
-/**
-* Advances the iterator's location using an in-order traversal.
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator& BinarySearchTree<Key, Value>::iterator::operator++()
-{
-    if(mCurrent->getRight() != NULL)
-    {
-        mCurrent = mCurrent->getRight();
-        while(mCurrent->getLeft() != NULL)
-        {
-            mCurrent = mCurrent->getLeft();
-        }
-    }
-    else if(mCurrent->getRight() == NULL)
-    {
-        Node<Key, Value>* parent = mCurrent->getParent();
-        while(parent != NULL && mCurrent == parent->getRight())
-        {
-            mCurrent = parent;
-            parent = parent->getParent();
-        }
-        mCurrent = parent;
-    }
-    return *this;
-}
-
-/*
-	-------------------------------------------------------------
-	End implementations for the BinarySearchTree::iterator class.
-	-------------------------------------------------------------
-*/
-
-/*
-	-----------------------------------------------------
-	Begin implementations for the BinarySearchTree class.
-	-----------------------------------------------------
-*/
-/**
-* Default constructor for a BinarySearchTree, which sets the root to NULL.
-*/
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::BinarySearchTree()
-{
-	mRoot = NULL;
-}
-
-/**
-* Deconstructor for a BinarySearchTree, which calls the clear function.
-*/
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
-{
-	this->clear();
-}
-
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
-{
-	printRoot(mRoot);
-	std::cout << "\n";
-}
-
-/**
-* Returns an iterator to the "smallest" item in the tree
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::begin() const
-{
-	BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-	return begin;
-}
-
-/**
-* Returns an iterator whose value means INVALID
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::end() const
-{
-	BinarySearchTree<Key, Value>::iterator end(NULL);
-	return end;
-}
-
-/**
-* Returns an iterator to the item with the given key, k
-* or the end iterator if k does not exist in the tree
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::find(const Key& key) const
-{
-	Node<Key, Value>* curr = internalFind(key);
-	BinarySearchTree<Key, Value>::iterator it(curr);
-	return it;
-}
-
-/**
-* An insert method to insert into a Binary Search Tree. The tree will not remain balanced when
-* inserting.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<Key, Value>& keyValuePair)
-{
-    // If this is the first Node, create the newNode
-    if (mRoot == NULL) {
-        mRoot = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
-	} else {
-        insertItem(keyValuePair, mRoot);
-    }
-}
-
-/**
- * A helper method for inserting into a Binary Search Tree that uses recursion
- */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::insertItem(const std::pair<Key, Value>& keyValuePair, Node<Key, Value>* root) {
-    auto rootKey = (root->getKey());
-    auto itemKey = keyValuePair.first;
-    // If the root's Key is greater than the new key, then the new key goes to the left
-    if (rootKey > itemKey) {
-        // If the left Child is empty, insert it there. Otherwise keep moving down on the left.
-        if (root->getLeft() == NULL) {
-            root->setLeft(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, root));
-        } else {
-            insertItem(keyValuePair, root->getLeft());
-        }
-    // If the root's Key is less than the new key, then the new key goes to the right
-    } else if (rootKey < itemKey) {
-        // If the Right Child is empty, insert it there. Otherwise keep moving down on the right.
-        if (root->getRight() == NULL) {
-            root->setRight(new Node<Key, Value>(keyValuePair.first, keyValuePair.second, root));
-        } else {
-            insertItem(keyValuePair, root->getRight());
-        }
-    // If the keys are the same, override the current value.
-    } else {
-        root->setValue(keyValuePair.second);
-    }
-}
-
-/**
-* An remove method to remove a specific key from a Binary Search Tree. The tree may not remain balanced after
-* removal.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
-{
-    auto rootNode = internalFind(key);                                          // Find the Node in tree
-    if (rootNode == NULL) {                                                     // If the Node doesn't exist, do nothing
-        return;
-    } else if (rootNode->getRight() != NULL && rootNode->getLeft() != NULL) {   // If the Node has Two Children
-        removeTwoChildren(rootNode);
-    } else if (rootNode->getRight() != NULL || rootNode->getLeft() != NULL) {   // If the Node has One Child
-        removeOneChild(rootNode);
-    } else {                                                                    // If the Node has Zero Children
-        removeZeroChildren(rootNode);
-    }
-
-}
-
-/**
-* A helper method to remove a specific Node from a Binary Search Tree with two children.
-*/
-
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeTwoChildren(Node<Key, Value>* root)
-{
-    // Finding the largest value in the left subtree
-    auto largest = getLargestNode(root->getLeft());
-
-    // Creating a new node to with the largest value in the right subtree
-    auto newNode = new Node<Key, Value>(largest->getKey(), largest->getValue(), root->getParent());
-    // Changing the pointers to the children both ways
-    newNode->setLeft(root->getLeft());                  // NewNode's left child is the root's left Child
-    newNode->setRight(root->getRight());                // NewNode's right child is the root's tight Child
-    newNode->getLeft()->setParent(newNode);             // NewNode is set as the parent of the root's left child
-    newNode->getRight()->setParent(newNode);            // NewNode is set as the parent of the root's right child
-
-    // Checks if the root has a parent or not
-    if (root->getParent() == NULL) {
-        mRoot = newNode;
-    } else {
-        // Checks which child of the parent this new node is going to be, either right or left
-        if ((root->getParent())->getLeft() == root) {
-            root->getParent()->setLeft(newNode);
-        } else {
-            root->getParent()->setRight(newNode);
-        }
-    }
-
-    // Removes the largest value from wherever it was found
-    if (largest->getLeft() != NULL) {
-        removeOneChild(largest);
-    } else {
-        removeZeroChildren(largest);
-    }
-
-    delete root;
-
-}
-
-/**
-* A helper method to remove a specific Node from a Binary Search Tree with one child.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeOneChild(Node<Key, Value>* root)
-{
-    // Check which side the child is on
-    if (root->getRight() != NULL) {
-        auto right = root->getRight();
-        auto parent = root->getParent();
-
-        // Changing the right child's pointer to point to the parent of the original node
-        right->setParent(parent);
-        // Replacing the original node with it's right child by changing the parent's pointer
-        if (parent->getRight() == root) {
-            parent->setRight(right);
-        } else {
-            parent->setLeft(right);
-        }
-
-        // Checking if the root node has a parent
-        if (root->getParent() == NULL) {
-            mRoot = right;
-        }
-
-        delete root;
-
-    } else {
-        auto left = root->getLeft();
-        auto parent = root->getParent();
-
-        // Changing the left child's pointer to point to the parent of the original node
-        left->setParent(parent);
-        // Replacing the original node with it's left child by changing the parent's pointer
-        if (parent->getLeft() == root) {
-            parent->setLeft(left);
-        } else {
-            parent->setRight(left);
-        }
-
-        // Checking if the node has a parent
-        if (root->getParent() == NULL) {
-            mRoot = left;
-        }
-
-        delete root;
-    }
-}
-
-/**
-* A helper method to remove a specific Node from a Binary Search Tree with zero children.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::removeZeroChildren(Node<Key, Value>* root)
-{
-    // If the node has no parent (i.e. only value), then set the base node to NULL
-    if (root->getParent() == NULL) {
-        mRoot = NULL;
-    }
-
-    // Checking what side the child is on for the parent, to set to NULL
-    if (root->getParent()->getLeft() == root) {
-        root->getParent()->setLeft(NULL);
-    } else {
-        root->getParent()->setRight(NULL);
-    }
-
-
-    delete root;
-
-}
-
-
-
-/**
-* A method to remove all contents of the tree and reset the values in the tree
-* for use again.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
-{
-    deleteTree(mRoot);
-    mRoot = NULL;
-}
-
-/**
-* A recursive helper function used to delete the Nodes before before deleting the actual Node.
-*/
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::deleteTree(Node<Key, Value>* root)
-{
-    if (root == NULL) {
-        return;
-    } else {
-        deleteTree(root->getLeft());
-        deleteTree(root->getRight());
-    }
-    delete root;
-}
-
-
-
-/**
-* A helper function to find the largest node in the tree.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::getLargestNode(Node<Key, Value>* root) const
-{
-    // Keep going on the right side until you reach the rightmost Node aka the largest Node
-    if (root->getRight() != NULL) {
-        return getLargestNode(root->getRight());
-    } else {
-        return root;
-    }
-}
-
-/**
-* A helper function to find the smallest node in the tree.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::getSmallestNode() const
-{
-    // Keep going on the left side until you reach the leftmost Node aka the smallest Node
-    auto smallest = mRoot;
-	while (smallest->getLeft() != NULL) {
-	    smallest = smallest->getLeft();
-	}
-	return smallest;
-}
-
-
-/**
-* Helper function to find a node with given key, k and
-* return a pointer to it or NULL if no item with that key
-* exists
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
-{
-    return insidefind(key, mRoot);
-}
-
-/**
-* Helper recursive method for internalFind
-*/
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::insidefind(const Key& key, Node<Key, Value>* root) const
-{
-    // If nothing is found return NULL
-    if (root == NULL) {
-        return NULL;
-    }
-
-    auto itemKey = key;
-    auto rootKey = root->getKey();
-
-    // Go on a certain side of the tree based on comparing the value to the root
-    if (itemKey > rootKey) {
-        return insidefind(key, root->getRight());
-    } else if (itemKey < rootKey) {
-        return insidefind(key, root->getLeft());
-    } else {
-        return root;
-    }
-}
-
-/**
- * Return true iff the BST is an AVL Tree.
- */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
-{
-    return balanceFactor(mRoot);
-}
-
-/**
- * Returns true if the balance factor is less than or equal to 1, AKA is balanced
- */
-
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::balanceFactor(Node<Key, Value>* root) const
-{
-    // If we reach a NULL node, return true
-    if (root == NULL) {
-        return true;
-    }
-    // First check the balance factor of the left side is false
-    if (!balanceFactor(root->getLeft())){
-        return false;
-    }
-    int leftHeight = getHeight(root->getLeft());        // Get the height of the left side
-    // Check the balance factor of the right side first
-    if (!balanceFactor(root->getRight())){
-        return false;
-    }
-    int rightHeight = getHeight(root->getRight());      // Get the height of the right side
-    return abs(rightHeight - leftHeight) <= 1;          // Calculating the balance factor and returning true/false
-
-}
-
-/**
- * Returns the height of a tree from the given root.
- */
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::getHeight(Node<Key, Value>* root) const
-{
-    // If we reach a NULL node, the height is 0
-    if (root == NULL) {
-        return 0;
-    } else {
-        int rightHeight = getHeight(root->getRight());      // Calling the function on right subtree
-        int leftHeight = getHeight(root->getLeft());        // Calling the function on left subtree
-
-        // Whichever height is larger, use that and add one to get the height of that Node
-        if (leftHeight > rightHeight) {
-            return leftHeight + 1;
-        } else {
-            return rightHeight + 1;
-        }
-    }
-}
-
-
-
-/**
- * Lastly, we are providing you with a print function, BinarySearchTree::printRoot().
-   Just call it with a node to start printing at, e.g:
-   this->printRoot(this->mRoot)
-   It will print up to 5 levels of the tree rooted at the passed node, in ASCII graphics format.
-   We hope it will make debugging easier!
-  */
-
-// include print function (in its own file because it's fairly long)
-#include "print_bst.h"
-#include "rotateBST.h"
-/*
-	---------------------------------------------------
-	End implementations for the BinarySearchTree class.
-	---------------------------------------------------
-*/
-
-#endif
-
+
+
+
+
+
+#ifndef BST_H
+#define BST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <utility>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <thread>
+#include <tuple>
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_three_way_comparison)
+#include <compare>
+#include <concepts>
+#endif
+#include "nodealloc.h"
+#include "frozentree.h"
+
+/**
+* A templated class for a Node in a search tree. Nothing in a Node is virtual, so a Node carries no vtable pointer
+* and the getters for parent/left/right inline to a plain load. Future kinds of search trees, such as Red Black
+* trees, Splay trees, and AVL trees, derive from Node and hide the getters with ones that return their own node
+* type, and the tree is told that node type through its NodeType template parameter.
+*/
+template <typename Key, typename Value>
+class Node
+{
+public:
+    Node(const Key& key, const Value& value, Node<Key, Value>* parent);
+    template <typename... Args>
+    Node(Node<Key, Value>* parent, Args&&... args);
+    ~Node();
+
+    const std::pair<Key, Value>& getItem() const;
+    std::pair<Key, Value>& getItem();
+    const Key& getKey() const;
+    const Value& getValue() const;
+    Key& getKey();
+    Value& getValue();
+
+    Node<Key, Value>* getParent() const;
+    Node<Key, Value>* getLeft() const;
+    Node<Key, Value>* getRight() const;
+
+    void setParent(Node<Key, Value>* parent);
+    void setLeft(Node<Key, Value>* left);
+    void setRight(Node<Key, Value>* right);
+    void setValue(const Value &value);
+    void setValue(Value&& value);
+
+protected:
+    std::pair<Key, Value> mItem;
+    Node<Key, Value>* mParent;
+    Node<Key, Value>* mLeft;
+    Node<Key, Value>* mRight;
+};
+
+/*
+	-----------------------------------------
+	Begin implementations for the Node class.
+	-----------------------------------------
+*/
+
+/**
+* Explicit constructor for a node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent)
+        : mItem(key, value)
+        , mParent(parent)
+        , mLeft(NULL)
+        , mRight(NULL)
+{
+
+}
+
+/**
+* Constructor for a node whose item is built in place from the given arguments, just like a std::pair would be
+* built from them. Nothing is copied unless the arguments themselves say so.
+*/
+template<typename Key, typename Value>
+template<typename... Args>
+Node<Key, Value>::Node(Node<Key, Value>* parent, Args&&... args)
+        : mItem(std::forward<Args>(args)...)
+        , mParent(parent)
+        , mLeft(NULL)
+        , mRight(NULL)
+{
+
+}
+
+/**
+* Destructor, which does not need to do anything since the pointers inside of a node
+* are only used as references to existing nodes. The nodes pointed to by parent/left/right
+* are freed within the deleteAll() helper method in the BinarySearchTree.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>::~Node()
+{
+
+}
+
+/**
+* A const getter for the item.
+*/
+template<typename Key, typename Value>
+const std::pair<Key, Value>& Node<Key, Value>::getItem() const
+{
+    return mItem;
+}
+
+/**
+* A non-const getter for the item.
+*/
+template<typename Key, typename Value>
+std::pair<Key, Value>& Node<Key, Value>::getItem()
+{
+    return mItem;
+}
+
+/**
+* A const getter for the key.
+*/
+template<typename Key, typename Value>
+const Key& Node<Key, Value>::getKey() const
+{
+    return mItem.first;
+}
+
+/**
+* A const getter for the value.
+*/
+template<typename Key, typename Value>
+const Value& Node<Key, Value>::getValue() const
+{
+    return mItem.second;
+}
+
+/**
+* A non-const getter for the key.
+*/
+template<typename Key, typename Value>
+Key& Node<Key, Value>::getKey()
+{
+    return mItem.first;
+}
+
+/**
+* A non-const getter for the value.
+*/
+template<typename Key, typename Value>
+Value& Node<Key, Value>::getValue()
+{
+    return mItem.second;
+}
+
+/**
+* A getter for the parent of a node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getParent() const
+{
+    return mParent;
+}
+
+/**
+* A getter for the left child of a node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getLeft() const
+{
+    return mLeft;
+}
+
+/**
+* A getter for the right child of a node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::getRight() const
+{
+    return mRight;
+}
+
+/**
+* A setter for setting the parent of a node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setParent(Node<Key, Value>* parent)
+{
+    mParent = parent;
+}
+
+/**
+* A setter for setting the left child of a node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setLeft(Node<Key, Value>* left)
+{
+    mLeft = left;
+}
+
+/**
+* A setter for setting the right child of a node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setRight(Node<Key, Value>* right)
+{
+    mRight = right;
+}
+
+/**
+* A setter for the value of a node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setValue(const Value& value)
+{
+    mItem.second = value;
+}
+
+/**
+* A setter that moves a new value into a node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setValue(Value&& value)
+{
+    mItem.second = std::move(value);
+}
+
+/*
+	---------------------------------------
+	End implementations for the Node class.
+	---------------------------------------
+*/
+
+/**
+* A Node that also keeps the number of Nodes in its subtree, which lets a tree answer size(), select() and rank()
+* in O(log n). A tree keeps the sizes up to date whenever its NodeType is, or derives from, a SizedNode.
+*/
+template <typename Key, typename Value>
+class SizedNode : public Node<Key, Value>
+{
+public:
+    SizedNode(const Key& key, const Value& value, SizedNode<Key, Value>* parent);
+    template <typename... Args>
+    SizedNode(SizedNode<Key, Value>* parent, Args&&... args);
+
+    std::size_t getSize() const;
+    void setSize(std::size_t size);
+
+    SizedNode<Key, Value>* getParent() const;
+    SizedNode<Key, Value>* getLeft() const;
+    SizedNode<Key, Value>* getRight() const;
+
+protected:
+    std::size_t mSize;
+};
+
+/*
+	----------------------------------------------
+	Begin implementations for the SizedNode class.
+	----------------------------------------------
+*/
+
+/**
+* Constructor for a SizedNode. A new Node is a subtree of size 1.
+*/
+template<typename Key, typename Value>
+SizedNode<Key, Value>::SizedNode(const Key& key, const Value& value, SizedNode<Key, Value>* parent)
+        : Node<Key, Value>(key, value, parent)
+        , mSize(1)
+{
+
+}
+
+/**
+* Constructor for a SizedNode whose item is built in place from the given arguments.
+*/
+template<typename Key, typename Value>
+template<typename... Args>
+SizedNode<Key, Value>::SizedNode(SizedNode<Key, Value>* parent, Args&&... args)
+        : Node<Key, Value>(parent, std::forward<Args>(args)...)
+        , mSize(1)
+{
+
+}
+
+/**
+* A getter for the number of Nodes in the subtree rooted at this Node.
+*/
+template<typename Key, typename Value>
+std::size_t SizedNode<Key, Value>::getSize() const
+{
+    return mSize;
+}
+
+/**
+* A setter for the number of Nodes in the subtree rooted at this Node.
+*/
+template<typename Key, typename Value>
+void SizedNode<Key, Value>::setSize(std::size_t size)
+{
+    mSize = size;
+}
+
+/**
+* A getter for the parent. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value>
+SizedNode<Key, Value>* SizedNode<Key, Value>::getParent() const
+{
+    return static_cast<SizedNode<Key, Value>*>(this->mParent);
+}
+
+/**
+* A getter for the left child. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value>
+SizedNode<Key, Value>* SizedNode<Key, Value>::getLeft() const
+{
+    return static_cast<SizedNode<Key, Value>*>(this->mLeft);
+}
+
+/**
+* A getter for the right child. Hides the base node's getter, and is only a cast.
+*/
+template<typename Key, typename Value>
+SizedNode<Key, Value>* SizedNode<Key, Value>::getRight() const
+{
+    return static_cast<SizedNode<Key, Value>*>(this->mRight);
+}
+
+/**
+* Returns the size of a subtree, where an empty subtree has a size of 0.
+*/
+template<typename Key, typename Value>
+std::size_t subtreeSize(const SizedNode<Key, Value>* node)
+{
+    if (node == NULL) {
+        return 0;
+    }
+    return node->getSize();
+}
+
+/**
+* Recomputes the size of a Node from its children. Nodes without a size have nothing to update, and overload
+* resolution picks this version for them.
+*/
+template<typename Key, typename Value>
+void updateSubtreeSize(Node<Key, Value>* /* node */)
+{
+
+}
+
+/**
+* Recomputes the size of a SizedNode, or of any Node derived from it, from its children.
+*/
+template<typename Key, typename Value>
+void updateSubtreeSize(SizedNode<Key, Value>* node)
+{
+    node->setSize(subtreeSize(node->getLeft()) + subtreeSize(node->getRight()) + 1);
+}
+
+/*
+	--------------------------------------------
+	End implementations for the SizedNode class.
+	--------------------------------------------
+*/
+
+/**
+* Orders two keys with a Compare, returning a negative number, zero or a positive number like a three-way
+* comparison. Any Compare can do this with at most two calls, one each way.
+*/
+template <typename Compare>
+struct KeyOrder
+{
+    template <typename A, typename B>
+    static int compare(const Compare& compare, const A& a, const B& b);
+};
+
+/**
+* Two calls each way.
+*/
+template <typename Compare>
+template <typename A, typename B>
+int KeyOrder<Compare>::compare(const Compare& compare, const A& a, const B& b)
+{
+    if (compare(a, b)) {
+        return -1;
+    }
+    return compare(b, a) ? 1 : 0;
+}
+
+#if defined(__cpp_lib_three_way_comparison)
+/**
+* With std::less, or the transparent std::less<>, the order is the keys' own operator<, so keys that also have a
+* <=> are ordered with that single call instead. This assumes that <=> agrees with <, as it does for the standard
+* types and for any type whose < is defaulted or derived from <=>.
+*/
+template <typename T>
+struct KeyOrder<std::less<T> >
+{
+    template <typename A, typename B>
+    static int compare(const std::less<T>& compare, const A& a, const B& b);
+};
+
+/**
+* One <=> if the keys have it, otherwise two calls each way.
+*/
+template <typename T>
+template <typename A, typename B>
+int KeyOrder<std::less<T> >::compare(const std::less<T>& compare, const A& a, const B& b)
+{
+    // Pointers are left to std::less, which orders them even where their built-in <=> does not
+    if constexpr (std::three_way_comparable_with<A, B> && !std::is_pointer<A>::value) {
+        auto order = a <=> b;
+        return (order < 0) ? -1 : ((order > 0) ? 1 : 0);
+    } else {
+        if (compare(a, b)) {
+            return -1;
+        }
+        return compare(b, a) ? 1 : 0;
+    }
+}
+#endif
+
+/**
+* A templated unbalanced binary search tree. Nodes are created and freed through the Allocator, and NodeType is
+* the kind of node the tree is built from, so that subclasses such as the AVLTree can store extra data per node.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator, typename NodeType = Node<Key, Value> >
+class BinarySearchTree
+{
+public:
+    BinarySearchTree();
+    explicit BinarySearchTree(const Compare& compare);
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other) noexcept;
+    virtual ~BinarySearchTree();
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other) noexcept;
+    virtual void insert(const std::pair<Key, Value>& keyValuePair);
+    void insert(std::pair<Key, Value>&& keyValuePair);
+    virtual void remove(const Key& key);
+    void clear();
+    void print() const;
+    bool isBalanced() const;
+    virtual void rebalance();
+    Compare key_comp() const;
+
+    // Order statistics, only available when the NodeType keeps subtree sizes (see SizedNode)
+    std::size_t size() const;
+    std::size_t rank(const Key& key) const;
+
+    // Methods for applying a whole batch of updates in one pass over the tree
+    template <typename InputIterator>
+    void insertBatch(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    void eraseBatch(InputIterator first, InputIterator last);
+
+    // Methods for removing every key in [lo, hi) at once
+    void eraseRange(const Key& lo, const Key& hi);
+    std::future<void> eraseRangeAsync(const Key& lo, const Key& hi);
+
+    // Methods for taking a read-only snapshot that is faster to search (see frozentree.h)
+    FrozenTree<Key, Value, Compare> freeze() const;
+    void freeze(FrozenTree<Key, Value, Compare>& frozen) const;
+
+private:
+    template <typename Pair>
+    void insertItem(Pair&& keyValuePair);
+    Node<Key, Value>* getLargestNode(Node<Key, Value>* root) const;
+    void removeTwoChildren(Node<Key,Value>* root);
+    void removeOneChild(Node<Key,Value>* root);
+    void removeZeroChildren(Node<Key,Value>* root);
+    bool balanceFactor(Node<Key, Value>* root) const;
+    void printLevels(Node<Key, Value>* root, int depth) const;
+    template <typename ForwardIterator>
+    Node<Key, Value>* buildSubtree(ForwardIterator& next, std::size_t count, Node<Key, Value>* parent);
+    Node<Key, Value>* splitPath(Node<Key, Value>* root, const Key& key, Node<Key, Value>*& right);
+    Node<Key, Value>* appendSubtree(Node<Key, Value>* left, Node<Key, Value>* right);
+    void compressVine(std::size_t count);
+
+public:
+    /**
+    * An internal iterator class for traversing the contents of the BST.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<Key, Value>* pointer;
+        typedef std::pair<Key, Value>& reference;
+
+        iterator(Node<Key,Value>* ptr);
+        iterator();
+
+        std::pair<Key,Value>& operator*() const;
+        std::pair<Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+        iterator& operator=(const iterator& rhs);
+
+        iterator& operator++();
+
+    protected:
+        Node<Key, Value>* mCurrent;
+
+        friend class BinarySearchTree<Key, Value, Compare, Allocator, NodeType>;
+    };
+
+    /**
+    * A view of the items whose keys lie in a half open interval [lo, hi), as returned by range(). It only holds
+    * two iterators, so it becomes invalid as soon as the tree is changed.
+    */
+    class Range
+    {
+    public:
+        Range(const iterator& first, const iterator& last);
+
+        iterator begin() const;
+        iterator end() const;
+        bool empty() const;
+
+    private:
+        iterator mFirst;
+        iterator mLast;
+    };
+
+public:
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator select(std::size_t index) const;
+    template <typename ForwardIterator, typename OutputIterator>
+    OutputIterator findMany(ForwardIterator first, ForwardIterator last, OutputIterator results) const;
+
+    // Ordered lookups, each takes one walk down the tree
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    iterator floor(const Key& key) const;
+    iterator ceiling(const Key& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+    Range range(const Key& lo, const Key& hi) const;
+
+    // The same lookups for any type that the Compare can compare with a Key, if the Compare is transparent (like
+    // std::less<>), so that for example a std::string_view can be looked up without building a std::string
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator find(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator lower_bound(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator upper_bound(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator floor(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    iterator ceiling(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    std::pair<iterator, iterator> equal_range(const K& key) const;
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    Range range(const K& lo, const K& hi) const;
+
+    // Methods that build a new item in place. Unlike insert(), they leave the value of an existing key alone,
+    // except for insert_or_assign()
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args);
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value);
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& value);
+
+private:
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplaceItem(K&& key, Args&&... args);
+    template <typename K, typename M>
+    std::pair<iterator, bool> insertOrAssignItem(K&& key, M&& value);
+    template <typename K>
+    Node<Key, Value>* findNode(const K& key) const;
+    template <typename K>
+    Node<Key, Value>* lowerBoundNode(const K& key) const;
+    template <typename K>
+    Node<Key, Value>* upperBoundNode(const K& key) const;
+    template <typename K>
+    Node<Key, Value>* floorNode(const K& key) const;
+    template <typename K>
+    Range rangeOf(const K& lo, const K& hi) const;
+
+protected:
+    Node<Key, Value>* internalFind(const Key& key) const; //TODO
+    Node<Key, Value>* getSmallestNode() const; //TODO
+    void printRoot (Node<Key, Value>* root) const;
+    NodeType* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    template <typename... Args>
+    NodeType* emplaceNode(Node<Key, Value>* parent, Args&&... args);
+    Node<Key, Value>* findSlot(const Key& key, Node<Key, Value>*& parent) const;
+    virtual void linkNode(Node<Key, Value>* node, Node<Key, Value>* parent);
+    void destroyNode(Node<Key, Value>* node);
+    void deleteTree(Node<Key, Value>* root);
+    virtual Node<Key, Value>* detachRange(const Key& lo, const Key& hi);
+    static void freeSubtree(Node<Key, Value>* root, Allocator<NodeType>& alloc);
+    static NodeType* cloneSubtree(Node<Key, Value>* source, Node<Key, Value>* parent, Allocator<NodeType>& alloc,
+                                  int depth);
+    static NodeType* copyNode(Node<Key, Value>* source, Node<Key, Value>* parent, Allocator<NodeType>& alloc);
+    static bool reachesDepth(Node<Key, Value>* root, int depth);
+    static int parallelDepth();
+    void sortBatch(std::vector<std::pair<Key, Value> >& items) const;
+    void sortKeys(std::vector<Key>& keys) const;
+    template <typename A, typename B>
+    int compareKeys(const A& a, const B& b) const;
+    void updateSize(Node<Key, Value>* node);
+    void updateSizesUpwards(Node<Key, Value>* node);
+    void leftRotate(Node<Key, Value>* r);
+    void rightRotate(Node<Key, Value>* r);
+    void leftRotate(Node<Key, Value>* r, Node<Key, Value>*& root);
+    void rightRotate(Node<Key, Value>* r, Node<Key, Value>*& root);
+
+    // Whether the Nodes keep subtree sizes that have to be maintained
+    static const bool HAS_SIZES = std::is_base_of<SizedNode<Key, Value>, NodeType>::value;
+
+    // A copy only hands a subtree to a thread of its own if the subtree reaches at least this deep
+    static const int PARALLEL_CLONE_DEPTH = 14;
+
+protected:
+    Node<Key, Value>* mRoot;
+    Allocator<NodeType> mAlloc;
+    Compare mCompare;
+
+public:
+    void print() {this->printRoot(this->mRoot);}
+
+};
+
+/*
+	---------------------------------------------------------------
+	Begin implementations for the BinarySearchTree::iterator class.
+	---------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a given node pointer.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::iterator(Node<Key,Value>* ptr)
+        : mCurrent(ptr)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to NULL.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::iterator()
+        : mCurrent(NULL)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::pair<Key, Value>& BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator*() const
+{
+    return mCurrent->getItem();
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::pair<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator->() const
+{
+    return &(mCurrent->getItem());
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator==(const BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator& rhs) const
+{
+    return this->mCurrent == rhs.mCurrent;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator!=(const BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator& rhs) const
+{
+    return this->mCurrent != rhs.mCurrent;
+}
+
+/**
+* Sets one iterator equal to another iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator &BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator=(const BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator& rhs)
+{
+    this->mCurrent = rhs.mCurrent;
+    return *this;
+}
+
+/**
+* Advances the iterator's location using an in-order traversal.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator& BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator::operator++()
+{
+    if(mCurrent->getRight() != NULL)
+    {
+        mCurrent = mCurrent->getRight();
+        while(mCurrent->getLeft() != NULL)
+        {
+            mCurrent = mCurrent->getLeft();
+        }
+    }
+    else if(mCurrent->getRight() == NULL)
+    {
+        Node<Key, Value>* parent = mCurrent->getParent();
+        while(parent != NULL && mCurrent == parent->getRight())
+        {
+            mCurrent = parent;
+            parent = parent->getParent();
+        }
+        mCurrent = parent;
+    }
+    return *this;
+}
+
+/*
+	-------------------------------------------------------------
+	End implementations for the BinarySearchTree::iterator class.
+	-------------------------------------------------------------
+*/
+
+/*
+	----------------------------------------------------------
+	Begin implementations for the BinarySearchTree::Range class.
+	----------------------------------------------------------
+*/
+
+/**
+* Constructor for a Range that holds the items from first up to, but not including, last.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range::Range(const iterator& first, const iterator& last)
+        : mFirst(first)
+        , mLast(last)
+{
+
+}
+
+/**
+* Returns an iterator to the first item in the Range.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range::begin() const
+{
+    return mFirst;
+}
+
+/**
+* Returns the iterator that ends the Range, which points at the first item past it (or is the tree's end()).
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range::end() const
+{
+    return mLast;
+}
+
+/**
+* Returns true if no item lies in the Range.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range::empty() const
+{
+    return mFirst == mLast;
+}
+
+/*
+	--------------------------------------------------------
+	End implementations for the BinarySearchTree::Range class.
+	--------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the BinarySearchTree class.
+	-----------------------------------------------------
+*/
+/**
+* Default constructor for a BinarySearchTree, which sets the root to NULL.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::BinarySearchTree()
+{
+	mRoot = NULL;
+}
+
+/**
+* Constructor for an empty BinarySearchTree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::BinarySearchTree(const Compare& compare)
+        : mCompare(compare)
+{
+	mRoot = NULL;
+}
+
+/**
+* Copy constructor, which clones the structure of the other tree Node for Node in O(n), with no comparisons.
+* The copy gets an allocator of its own rather than sharing the other tree's, and with a thread safe allocator the
+* subtrees near the top of a large tree are cloned in parallel.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::BinarySearchTree(const BinarySearchTree& other)
+        : mCompare(other.mCompare)
+{
+	mRoot = NULL;
+	mRoot = cloneSubtree(other.mRoot, NULL, mAlloc, Allocator<NodeType>::THREAD_SAFE ? parallelDepth() : 0);
+}
+
+/**
+* Move constructor, which takes over the other tree's Nodes and allocator in O(1) and leaves it empty.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::BinarySearchTree(BinarySearchTree&& other) noexcept
+        : mAlloc(std::move(other.mAlloc)), mCompare(other.mCompare)
+{
+	mRoot = other.mRoot;
+	other.mRoot = NULL;
+	other.mAlloc = Allocator<NodeType>();
+}
+
+/**
+* Deconstructor for a BinarySearchTree, which calls the clear function.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::~BinarySearchTree()
+{
+	this->clear();
+}
+
+/**
+* Copy assignment, which clones the other tree the same way as the copy constructor. The clone is built with a
+* new allocator before the old Nodes are freed, so the tree is left unchanged if copying an item throws.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>& BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::operator=(const BinarySearchTree& other)
+{
+	if (this != &other) {
+		Allocator<NodeType> alloc;
+		auto root = cloneSubtree(other.mRoot, NULL, alloc, Allocator<NodeType>::THREAD_SAFE ? parallelDepth() : 0);
+		clear();
+		mRoot = root;
+		mAlloc = std::move(alloc);
+		mCompare = other.mCompare;
+	}
+	return *this;
+}
+
+/**
+* Move assignment, which frees this tree's Nodes and takes over the other tree's Nodes and allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+BinarySearchTree<Key, Value, Compare, Allocator, NodeType>& BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::operator=(BinarySearchTree&& other) noexcept
+{
+	if (this != &other) {
+		clear();
+		mRoot = other.mRoot;
+		mAlloc = std::move(other.mAlloc);
+		mCompare = other.mCompare;
+		other.mRoot = NULL;
+		other.mAlloc = Allocator<NodeType>();
+	}
+	return *this;
+}
+
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::print() const
+{
+	printRoot(mRoot);
+	std::cout << "\n";
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::begin() const
+{
+	BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator begin(getSmallestNode());
+	return begin;
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::end() const
+{
+	BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator end(NULL);
+	return end;
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::find(const Key& key) const
+{
+	Node<Key, Value>* curr = internalFind(key);
+	BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator it(curr);
+	return it;
+}
+
+/**
+* Looks up every key in [first, last) and writes an iterator per key to results, in the same order, with the end
+* iterator for a missing key. Returns results past the last one written, like std::copy().
+*
+* Each find() stalls on a cache miss at almost every level of a large tree. Here a group of lookups walks down in
+* lockstep, one level at a time, and each step prefetches the child a lookup will read next, so that the misses
+* of the whole group are waited for together instead of one after another.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename ForwardIterator, typename OutputIterator>
+OutputIterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::findMany(ForwardIterator first, ForwardIterator last, OutputIterator results) const
+{
+    // Enough lookups to keep the memory system busy, but few enough that their state stays in registers and L1
+    const std::size_t GROUP = 16;
+    const Key* keys[GROUP];
+    Node<Key, Value>* current[GROUP];
+    Node<Key, Value>* found[GROUP];
+
+    while (first != last) {
+        // Starting the next group of lookups at the root
+        std::size_t count = 0;
+        for (; count < GROUP && first != last; ++first, count++) {
+            keys[count] = &*first;
+            current[count] = mRoot;
+            found[count] = NULL;
+        }
+
+        // Taking one step down for every lookup that is still going, until all of them have ended
+        std::size_t active = count;
+        while (active > 0) {
+            active = 0;
+            for (std::size_t i = 0; i < count; i++) {
+                auto root = current[i];
+                if (root == NULL) {
+                    continue;
+                }
+                int order = compareKeys(*keys[i], root->getKey());
+                if (order == 0) {
+                    found[i] = root;
+                    current[i] = NULL;
+                    continue;
+                }
+                root = (order < 0) ? root->getLeft() : root->getRight();
+                current[i] = root;
+                if (root != NULL) {
+#if defined(__GNUC__)
+                    __builtin_prefetch(root);
+#endif
+                    active++;
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            *results = iterator(found[i]);
+            ++results;
+        }
+    }
+    return results;
+}
+
+/**
+* Returns an iterator to the first item whose key is not smaller than the given key, or the end iterator if there
+* is none.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::lower_bound(const Key& key) const
+{
+    return iterator(lowerBoundNode(key));
+}
+
+/**
+* Returns an iterator to the first item whose key is larger than the given key, or the end iterator if there is
+* none.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::upper_bound(const Key& key) const
+{
+    return iterator(upperBoundNode(key));
+}
+
+/**
+* Returns an iterator to the item with the largest key that is not larger than the given key (its predecessor, or
+* the key itself), or the end iterator if every key is larger.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::floor(const Key& key) const
+{
+    return iterator(floorNode(key));
+}
+
+/**
+* Returns an iterator to the item with the smallest key that is not smaller than the given key (its successor, or
+* the key itself), or the end iterator if every key is smaller. The same as lower_bound().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::ceiling(const Key& key) const
+{
+    return iterator(lowerBoundNode(key));
+}
+
+/**
+* Returns the lower_bound() and upper_bound() of a key, which hold the key's item if it is in the tree and are
+* equal otherwise.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::equal_range(const Key& key) const
+{
+    return std::make_pair(iterator(lowerBoundNode(key)), iterator(upperBoundNode(key)));
+}
+
+/**
+* Returns a view of the items with lo <= key < hi. Finding both ends takes O(log n), and walking the view costs
+* one iterator step per item. The view is empty unless lo < hi.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::range(const Key& lo, const Key& hi) const
+{
+    return rangeOf(lo, hi);
+}
+
+/**
+* The same as find(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::find(const K& key) const
+{
+    return iterator(findNode(key));
+}
+
+/**
+* The same as lower_bound(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::lower_bound(const K& key) const
+{
+    return iterator(lowerBoundNode(key));
+}
+
+/**
+* The same as upper_bound(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::upper_bound(const K& key) const
+{
+    return iterator(upperBoundNode(key));
+}
+
+/**
+* The same as floor(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::floor(const K& key) const
+{
+    return iterator(floorNode(key));
+}
+
+/**
+* The same as ceiling(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::ceiling(const K& key) const
+{
+    return iterator(lowerBoundNode(key));
+}
+
+/**
+* The same as equal_range(), for a key of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::equal_range(const K& key) const
+{
+    return std::make_pair(iterator(lowerBoundNode(key)), iterator(upperBoundNode(key)));
+}
+
+/**
+* The same as range(), for bounds of another type that the transparent Compare can compare with a Key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::range(const K& lo, const K& hi) const
+{
+    return rangeOf(lo, hi);
+}
+
+/**
+* A helper function for the lookups that walks down to the Node with a key equivalent to the given one, with a
+* single three-way comparison per level where the keys allow it. Returns NULL if there is no such Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::findNode(const K& key) const
+{
+    auto root = mRoot;
+    while (root != NULL) {
+        int order = compareKeys(key, root->getKey());
+        if (order < 0) {
+            root = root->getLeft();
+        } else if (order > 0) {
+            root = root->getRight();
+        } else {
+            return root;
+        }
+    }
+    return NULL;
+}
+
+/**
+* A helper function that finds the first Node whose key is not smaller than the given key, or NULL.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::lowerBoundNode(const K& key) const
+{
+    // The last Node where the walk turned left is the smallest key seen so far that is not smaller than key
+    Node<Key, Value>* bound = NULL;
+    auto root = mRoot;
+    while (root != NULL) {
+        if (mCompare(root->getKey(), key)) {
+            root = root->getRight();
+        } else {
+            bound = root;
+            root = root->getLeft();
+        }
+    }
+    return bound;
+}
+
+/**
+* A helper function that finds the first Node whose key is larger than the given key, or NULL.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::upperBoundNode(const K& key) const
+{
+    Node<Key, Value>* bound = NULL;
+    auto root = mRoot;
+    while (root != NULL) {
+        if (mCompare(key, root->getKey())) {
+            bound = root;
+            root = root->getLeft();
+        } else {
+            root = root->getRight();
+        }
+    }
+    return bound;
+}
+
+/**
+* A helper function that finds the last Node whose key is not larger than the given key, or NULL.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::floorNode(const K& key) const
+{
+    // The iterator cannot step backwards, so this is a walk of its own: the last Node where it turned right
+    Node<Key, Value>* bound = NULL;
+    auto root = mRoot;
+    while (root != NULL) {
+        if (mCompare(key, root->getKey())) {
+            root = root->getLeft();
+        } else {
+            bound = root;
+            root = root->getRight();
+        }
+    }
+    return bound;
+}
+
+/**
+* A helper function for both range() overloads.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::Range BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rangeOf(const K& lo, const K& hi) const
+{
+    iterator last(lowerBoundNode(hi));
+    if (!mCompare(lo, hi)) {
+        return Range(last, last);
+    }
+    return Range(iterator(lowerBoundNode(lo)), last);
+}
+
+/**
+* An insert method to insert into a Binary Search Tree. The tree will not remain balanced when
+* inserting.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    insertItem(keyValuePair);
+}
+
+/**
+* An insert method that moves the key and value into the tree instead of copying them. If the key is already in
+* the tree, only the value is moved over.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insert(std::pair<Key, Value>&& keyValuePair)
+{
+    insertItem(std::move(keyValuePair));
+}
+
+/**
+ * A helper method for both inserts that finds the spot for the key and then either overwrites the value that is
+ * there or links in a new Node built straight from the pair, copying or moving it as the caller passed it.
+ */
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename Pair>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insertItem(Pair&& keyValuePair) {
+    Node<Key, Value>* parent;
+    auto found = findSlot(keyValuePair.first, parent);
+    // If the keys are the same, override the current value.
+    if (found != NULL) {
+        found->setValue(std::forward<Pair>(keyValuePair).second);
+        return;
+    }
+    linkNode(emplaceNode(NULL, std::forward<Pair>(keyValuePair)), parent);
+}
+
+/**
+* Builds an item from the arguments, just like a std::pair would be built from them, and inserts it unless its key
+* is already in the tree. Returns an iterator to the item with that key, and whether it was inserted. The Node is
+* built before the key is known, so a duplicate costs one Node that is freed again; try_emplace() avoids that.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::emplace(Args&&... args)
+{
+    auto node = emplaceNode(NULL, std::forward<Args>(args)...);
+    Node<Key, Value>* parent;
+    auto found = findSlot(node->getKey(), parent);
+    if (found != NULL) {
+        destroyNode(node);
+        return std::make_pair(iterator(found), false);
+    }
+    linkNode(node, parent);
+    return std::make_pair(iterator(node), true);
+}
+
+/**
+* Inserts the key with a value built from the arguments if the key is not in the tree yet, and otherwise leaves
+* the tree, the key and the arguments untouched. Returns an iterator to the item with that key, and whether it was
+* inserted.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::try_emplace(const Key& key, Args&&... args)
+{
+    return tryEmplaceItem(key, std::forward<Args>(args)...);
+}
+
+/**
+* The same as the other try_emplace(), but moves the key into the new Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::try_emplace(Key&& key, Args&&... args)
+{
+    return tryEmplaceItem(std::move(key), std::forward<Args>(args)...);
+}
+
+/**
+* Inserts the key with the given value, or assigns the value to the key if it is already in the tree. Returns an
+* iterator to the item with that key, and whether it was inserted.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insert_or_assign(const Key& key, M&& value)
+{
+    return insertOrAssignItem(key, std::forward<M>(value));
+}
+
+/**
+* The same as the other insert_or_assign(), but moves the key into the new Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insert_or_assign(Key&& key, M&& value)
+{
+    return insertOrAssignItem(std::move(key), std::forward<M>(value));
+}
+
+/**
+* A helper function for both try_emplace() overloads, which only builds a Node once the key is known to be new.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::tryEmplaceItem(K&& key, Args&&... args)
+{
+    Node<Key, Value>* parent;
+    auto found = findSlot(key, parent);
+    if (found != NULL) {
+        return std::make_pair(iterator(found), false);
+    }
+    auto node = emplaceNode(NULL, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+    linkNode(node, parent);
+    return std::make_pair(iterator(node), true);
+}
+
+/**
+* A helper function for both insert_or_assign() overloads.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename K, typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator, bool> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insertOrAssignItem(K&& key, M&& value)
+{
+    Node<Key, Value>* parent;
+    auto found = findSlot(key, parent);
+    if (found != NULL) {
+        found->getValue() = std::forward<M>(value);
+        return std::make_pair(iterator(found), false);
+    }
+    auto node = emplaceNode(NULL, std::forward<K>(key), std::forward<M>(value));
+    linkNode(node, parent);
+    return std::make_pair(iterator(node), true);
+}
+
+/**
+* Walks down the tree looking for a key without copying anything. Returns the Node with the key if there is one.
+* Otherwise returns NULL and sets parent to the Node a new Node with the key would hang from, which is NULL for an
+* empty tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::findSlot(const Key& key, Node<Key, Value>*& parent) const
+{
+    parent = NULL;
+    auto root = mRoot;
+    while (root != NULL) {
+        int order = compareKeys(key, root->getKey());
+        if (order < 0) {
+            parent = root;
+            root = root->getLeft();
+        } else if (order > 0) {
+            parent = root;
+            root = root->getRight();
+        } else {
+            return root;
+        }
+    }
+    return NULL;
+}
+
+/**
+* Links a new, detached Node into the empty spot below parent that findSlot() found for its key, or makes it the
+* root if parent is NULL, and updates the subtree sizes. Balanced trees override this to rebalance afterwards.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::linkNode(Node<Key, Value>* node, Node<Key, Value>* parent)
+{
+    node->setParent(parent);
+    if (parent == NULL) {
+        mRoot = node;
+        return;
+    }
+    if (mCompare(node->getKey(), parent->getKey())) {
+        parent->setLeft(node);
+    } else {
+        parent->setRight(node);
+    }
+    updateSizesUpwards(parent);
+}
+
+/**
+* An remove method to remove a specific key from a Binary Search Tree. The tree may not remain balanced after
+* removal.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::remove(const Key& key)
+{
+    auto rootNode = internalFind(key);                                          // Find the Node in tree
+    if (rootNode == NULL) {                                                     // If the Node doesn't exist, do nothing
+        return;
+    } else if (rootNode->getRight() != NULL && rootNode->getLeft() != NULL) {   // If the Node has Two Children
+        removeTwoChildren(rootNode);
+    } else if (rootNode->getRight() != NULL || rootNode->getLeft() != NULL) {   // If the Node has One Child
+        removeOneChild(rootNode);
+    } else {                                                                    // If the Node has Zero Children
+        removeZeroChildren(rootNode);
+    }
+
+}
+
+/**
+* A helper method to remove a specific Node from a Binary Search Tree with two children.
+*/
+
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::removeTwoChildren(Node<Key, Value>* root)
+{
+    // Finding the largest value in the left subtree, which has no right child
+    auto largest = getLargestNode(root->getLeft());
+    auto largestParent = largest->getParent();
+
+    // Unlinking the largest Node from its spot, unless it is the root's own left child and simply moves up
+    if (largestParent != root) {
+        largestParent->setRight(largest->getLeft());
+        if (largest->getLeft() != NULL) {
+            largest->getLeft()->setParent(largestParent);
+        }
+        largest->setLeft(root->getLeft());
+        largest->getLeft()->setParent(largest);
+    }
+
+    // Relinking the largest Node into the root's place, so no Node has to be created or copied
+    largest->setRight(root->getRight());
+    largest->getRight()->setParent(largest);
+    largest->setParent(root->getParent());
+    if (root->getParent() == NULL) {
+        mRoot = largest;
+    } else if (root->getParent()->getLeft() == root) {
+        root->getParent()->setLeft(largest);
+    } else {
+        root->getParent()->setRight(largest);
+    }
+
+    updateSizesUpwards(largestParent != root ? largestParent : largest);
+    destroyNode(root);
+}
+
+/**
+* A helper method to remove a specific Node from a Binary Search Tree with one child.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::removeOneChild(Node<Key, Value>* root)
+{
+    // Check which side the child is on
+    auto child = (root->getRight() != NULL) ? root->getRight() : root->getLeft();
+    auto parent = root->getParent();
+
+    // Changing the child's pointer to point to the parent of the original node
+    child->setParent(parent);
+    // Replacing the original node with it's child by changing the parent's pointer, or the root if there is none
+    if (parent == NULL) {
+        mRoot = child;
+    } else if (parent->getRight() == root) {
+        parent->setRight(child);
+    } else {
+        parent->setLeft(child);
+    }
+
+    updateSizesUpwards(parent);
+    destroyNode(root);
+}
+
+/**
+* A helper method to remove a specific Node from a Binary Search Tree with zero children.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::removeZeroChildren(Node<Key, Value>* root)
+{
+    auto parent = root->getParent();
+
+    // If the node has no parent (i.e. only value), then set the base node to NULL
+    if (parent == NULL) {
+        mRoot = NULL;
+    // Checking what side the child is on for the parent, to set to NULL
+    } else if (parent->getLeft() == root) {
+        parent->setLeft(NULL);
+    } else {
+        parent->setRight(NULL);
+    }
+
+    updateSizesUpwards(parent);
+    destroyNode(root);
+}
+
+/**
+* Inserts every pair in [first, last) in a single top-down pass. The batch is sorted first, so each Node only has
+* to be compared against the part of the batch that falls into its subtree, and a part that reaches an empty
+* child is attached there as a balanced subtree. A later pair wins over an earlier one with the same key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::insertBatch(InputIterator first, InputIterator last)
+{
+    std::vector<std::pair<Key, Value> > items(first, last);
+    sortBatch(items);
+    if (items.empty()) {
+        return;
+    }
+    if (mRoot == NULL) {
+        auto next = items.begin();
+        mRoot = buildSubtree(next, items.size(), NULL);
+        return;
+    }
+
+    // Each piece of work is a Node together with the slice of the batch that belongs in its subtree
+    struct Slice {
+        Node<Key, Value>* root;
+        std::size_t begin;
+        std::size_t end;
+    };
+    std::vector<Slice> work(1, Slice{mRoot, 0, items.size()});
+    std::vector<Node<Key, Value>*> visited;
+    while (!work.empty()) {
+        Slice slice = work.back();
+        work.pop_back();
+        auto root = slice.root;
+        if (HAS_SIZES) {
+            visited.push_back(root);
+        }
+
+        // Splitting the slice around the Node's key, and overwriting the Node's value if its key is in the batch
+        auto split = std::lower_bound(items.begin() + slice.begin, items.begin() + slice.end, root->getKey(),
+                                      [this](const std::pair<Key, Value>& item, const Key& key) { return mCompare(item.first, key); });
+        std::size_t middle = split - items.begin();
+        std::size_t rightBegin = middle;
+        if (middle != slice.end && !mCompare(root->getKey(), items[middle].first)) {
+            root->setValue(items[middle].second);
+            rightBegin++;
+        }
+
+        // Smaller keys go to the left, either down into the subtree or as a new subtree
+        if (slice.begin != middle) {
+            if (root->getLeft() == NULL) {
+                auto next = items.begin() + slice.begin;
+                root->setLeft(buildSubtree(next, middle - slice.begin, root));
+            } else {
+                work.push_back(Slice{root->getLeft(), slice.begin, middle});
+            }
+        }
+        // Larger keys go to the right in the same way
+        if (rightBegin != slice.end) {
+            if (root->getRight() == NULL) {
+                auto next = items.begin() + rightBegin;
+                root->setRight(buildSubtree(next, slice.end - rightBegin, root));
+            } else {
+                work.push_back(Slice{root->getRight(), rightBegin, slice.end});
+            }
+        }
+    }
+
+    // Every Node was visited before its descendants, so going backwards fixes the sizes from the bottom up
+    for (auto it = visited.rbegin(); it != visited.rend(); ++it) {
+        updateSize(*it);
+    }
+}
+
+/**
+* Removes every key in [first, last) in a single top-down pass. The sorted keys are split around each Node so that
+* the paths shared by several keys are only walked once, and then the matching Nodes are removed deepest first so
+* that a removal never invalidates a Node that is still waiting to be removed.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename InputIterator>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::eraseBatch(InputIterator first, InputIterator last)
+{
+    std::vector<Key> keys(first, last);
+    sortKeys(keys);
+
+    struct Slice {
+        Node<Key, Value>* root;
+        std::size_t begin;
+        std::size_t end;
+    };
+    std::vector<Node<Key, Value>*> found;
+    std::vector<Slice> work;
+    if (mRoot != NULL && !keys.empty()) {
+        work.push_back(Slice{mRoot, 0, keys.size()});
+    }
+    while (!work.empty()) {
+        Slice slice = work.back();
+        work.pop_back();
+        auto root = slice.root;
+
+        auto split = std::lower_bound(keys.begin() + slice.begin, keys.begin() + slice.end, root->getKey(), mCompare);
+        std::size_t middle = split - keys.begin();
+        std::size_t rightBegin = middle;
+        if (middle != slice.end && !mCompare(root->getKey(), keys[middle])) {
+            found.push_back(root);
+            rightBegin++;
+        }
+        if (slice.begin != middle && root->getLeft() != NULL) {
+            work.push_back(Slice{root->getLeft(), slice.begin, middle});
+        }
+        if (rightBegin != slice.end && root->getRight() != NULL) {
+            work.push_back(Slice{root->getRight(), rightBegin, slice.end});
+        }
+    }
+
+    // Every Node was found before any of its descendants, so going backwards removes descendants first
+    for (auto it = found.rbegin(); it != found.rend(); ++it) {
+        auto root = *it;
+        if (root->getRight() != NULL && root->getLeft() != NULL) {
+            removeTwoChildren(root);
+        } else if (root->getRight() != NULL || root->getLeft() != NULL) {
+            removeOneChild(root);
+        } else {
+            removeZeroChildren(root);
+        }
+    }
+}
+
+/**
+* Removes every item with lo <= key < hi. The items are cut out of the tree as whole subtrees along the search
+* paths of lo and hi, so the tree itself is fixed up in O(height), and then the cut out Nodes are freed.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::eraseRange(const Key& lo, const Key& hi)
+{
+    freeSubtree(detachRange(lo, hi), mAlloc);
+}
+
+/**
+* Removes every item with lo <= key < hi like eraseRange(), but frees the cut out Nodes on a background thread, so
+* the call only costs the O(height) cut. The tree can be used again right away. The returned future finishes when
+* the Nodes are freed, and has to be kept alive for the freeing to overlap with the caller, since destroying it
+* waits. Needs an allocator that may be used from several threads at once.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::future<void> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::eraseRangeAsync(const Key& lo, const Key& hi)
+{
+    static_assert(Allocator<NodeType>::THREAD_SAFE, "eraseRangeAsync() needs a thread safe allocator");
+    auto detached = detachRange(lo, hi);
+    if (detached == NULL) {
+        std::promise<void> done;
+        done.set_value();
+        return done.get_future();
+    }
+    Allocator<NodeType> alloc(mAlloc);
+    return std::async(std::launch::async, [detached, alloc]() mutable {
+        freeSubtree(detached, alloc);
+    });
+}
+
+/**
+* Returns a read-only copy of the tree in Eytzinger order, which answers find() and lower_bound() with fewer cache
+* misses than the tree itself. Building it takes one in-order walk and no key comparisons. The copy does not
+* follow later changes to the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+FrozenTree<Key, Value, Compare> BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::freeze() const
+{
+    return FrozenTree<Key, Value, Compare>(begin(), end(), mCompare);
+}
+
+/**
+* Refreshes an earlier freeze() of the tree, typically after a batch of writes. The arrays of frozen are reused
+* when the tree has not grown past them, so nothing is allocated.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::freeze(FrozenTree<Key, Value, Compare>& frozen) const
+{
+    frozen.assign(begin(), end(), mCompare);
+}
+
+/**
+* Cuts every Node with lo <= key < hi out of the tree and returns them as one detached subtree, or NULL if there
+* are none. Splitting off the keys below lo and then the keys from hi on only walks those two search paths, and
+* the two outer parts are glued back together under the largest key below lo.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::detachRange(const Key& lo, const Key& hi)
+{
+    if (!mCompare(lo, hi)) {
+        return NULL;
+    }
+    Node<Key, Value>* rest;
+    Node<Key, Value>* right;
+    auto left = splitPath(mRoot, lo, rest);
+    auto middle = splitPath(rest, hi, right);
+    mRoot = appendSubtree(left, right);
+    return middle;
+}
+
+/**
+* A helper function that splits a subtree around a key by walking down the key's search path once. Each Node on
+* the path goes, along with the child subtree away from the key, to the left result if its key is smaller than the
+* given key and to the right result otherwise. Returns the left result, and both results are detached.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::splitPath(Node<Key, Value>* root, const Key& key, Node<Key, Value>*& right)
+{
+    Node<Key, Value>* left = NULL;
+    right = NULL;
+    // The last Node added to each side, whose right (or left) child is the open spot for the next one
+    Node<Key, Value>* leftTail = NULL;
+    Node<Key, Value>* rightTail = NULL;
+    std::vector<Node<Key, Value>*> visited;
+
+    while (root != NULL) {
+        if (HAS_SIZES) {
+            visited.push_back(root);
+        }
+        Node<Key, Value>* next;
+        if (mCompare(root->getKey(), key)) {
+            next = root->getRight();
+            root->setRight(NULL);
+            root->setParent(leftTail);
+            if (leftTail == NULL) {
+                left = root;
+            } else {
+                leftTail->setRight(root);
+            }
+            leftTail = root;
+        } else {
+            next = root->getLeft();
+            root->setLeft(NULL);
+            root->setParent(rightTail);
+            if (rightTail == NULL) {
+                right = root;
+            } else {
+                rightTail->setLeft(root);
+            }
+            rightTail = root;
+        }
+        root = next;
+    }
+
+    // A Node's new children were visited after it, so going backwards fixes the sizes from the bottom up
+    for (auto it = visited.rbegin(); it != visited.rend(); ++it) {
+        updateSize(*it);
+    }
+    return left;
+}
+
+/**
+* A helper function that hangs a detached subtree under the largest Node of another one, where every key of the
+* right subtree is larger than every key of the left one. Returns the root of the result.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::appendSubtree(Node<Key, Value>* left, Node<Key, Value>* right)
+{
+    if (left == NULL) {
+        return right;
+    }
+    if (right != NULL) {
+        auto largest = left;
+        while (largest->getRight() != NULL) {
+            largest = largest->getRight();
+        }
+        largest->setRight(right);
+        right->setParent(largest);
+        updateSizesUpwards(largest);
+    }
+    return left;
+}
+
+/**
+* Destroys every Node of a detached subtree with the given allocator. Each left child is rotated up before its
+* parent is freed, so the walk needs neither recursion nor a stack, and it uses nothing of the tree, so it can run
+* on another thread.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::freeSubtree(Node<Key, Value>* root, Allocator<NodeType>& alloc)
+{
+    while (root != NULL) {
+        auto left = root->getLeft();
+        if (left != NULL) {
+            root->setLeft(left->getRight());
+            left->setRight(root);
+            root = left;
+        } else {
+            auto right = root->getRight();
+            NodeType* typedNode = static_cast<NodeType*>(root);
+            typedNode->~NodeType();
+            alloc.deallocate(typedNode);
+            root = right;
+        }
+    }
+}
+
+/**
+* A helper function that copies a subtree Node for Node, with the copy of source hung under parent. Each copy is
+* made with the NodeType's copy constructor, so heights and subtree sizes come along without being recomputed.
+*
+* While depth is left and both sides are deep enough, the left side is copied by another thread. Below that the
+* walk is iterative, going down through the first child not copied yet and back up through the parent pointers,
+* so a degenerate tree needs no stack. If a copy throws, everything copied so far is freed.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::cloneSubtree(Node<Key, Value>* source, Node<Key, Value>* parent,
+                                                                                 Allocator<NodeType>& alloc, int depth)
+{
+    if (source == NULL) {
+        return NULL;
+    }
+    auto root = copyNode(source, parent, alloc);
+
+    if (depth > 0 && reachesDepth(source->getLeft(), PARALLEL_CLONE_DEPTH) &&
+            reachesDepth(source->getRight(), PARALLEL_CLONE_DEPTH)) {
+        std::future<NodeType*> leftTask;
+        try {
+            leftTask = std::async(std::launch::async, [source, root, &alloc, depth]() {
+                return cloneSubtree(source->getLeft(), root, alloc, depth - 1);
+            });
+            root->setRight(cloneSubtree(source->getRight(), root, alloc, depth - 1));
+            root->setLeft(leftTask.get());
+        } catch (...) {
+            if (leftTask.valid()) {
+                try {
+                    root->setLeft(leftTask.get());
+                } catch (...) {
+                }
+            }
+            freeSubtree(root, alloc);
+            throw;
+        }
+        return root;
+    }
+
+    try {
+        Node<Key, Value>* current = source;
+        Node<Key, Value>* copy = root;
+        while (true) {
+            if (current->getLeft() != NULL && copy->getLeft() == NULL) {
+                copy->setLeft(copyNode(current->getLeft(), copy, alloc));
+                current = current->getLeft();
+                copy = copy->getLeft();
+            } else if (current->getRight() != NULL && copy->getRight() == NULL) {
+                copy->setRight(copyNode(current->getRight(), copy, alloc));
+                current = current->getRight();
+                copy = copy->getRight();
+            } else if (copy != root) {
+                current = current->getParent();
+                copy = copy->getParent();
+            } else {
+                break;
+            }
+        }
+    } catch (...) {
+        freeSubtree(root, alloc);
+        throw;
+    }
+    return root;
+}
+
+/**
+* A helper function that copies a single Node, item and all, from the allocator. The copy starts out without
+* children.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::copyNode(Node<Key, Value>* source, Node<Key, Value>* parent,
+                                                                             Allocator<NodeType>& alloc)
+{
+    NodeType* memory = alloc.allocate();
+    NodeType* copy;
+    try {
+        copy = new (memory) NodeType(*static_cast<NodeType*>(source));
+    } catch (...) {
+        alloc.deallocate(memory);
+        throw;
+    }
+    copy->setParent(parent);
+    copy->setLeft(NULL);
+    copy->setRight(NULL);
+    return copy;
+}
+
+/**
+* A helper function that checks whether a subtree has a path at least depth Nodes long, following the left child
+* wherever there is one. For a balanced tree that is its height, so the subtree holds at least 2^depth Nodes.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::reachesDepth(Node<Key, Value>* root, int depth)
+{
+    while (root != NULL && depth > 0) {
+        root = (root->getLeft() != NULL) ? root->getLeft() : root->getRight();
+        depth--;
+    }
+    return depth == 0;
+}
+
+/**
+* Returns how many levels of a parallel operation may still fork off a thread, enough for every hardware thread to
+* get some work. A machine with a single hardware thread never forks.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+int BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::parallelDepth()
+{
+    unsigned int threads = std::thread::hardware_concurrency();
+    int depth = 0;
+    while (threads > 1) {
+        threads = (threads + 1) / 2;
+        depth++;
+    }
+    return depth;
+}
+
+/**
+* A helper function that builds a balanced subtree out of the next count pairs in sorted order, reading them
+* strictly front to back. Returns the root of the subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename ForwardIterator>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::buildSubtree(ForwardIterator& next, std::size_t count, Node<Key, Value>* parent)
+{
+    if (count == 0) {
+        return NULL;
+    }
+
+    std::size_t leftCount = count / 2;
+    auto left = buildSubtree(next, leftCount, NULL);
+    auto root = createNode(next->first, next->second, parent);
+    ++next;
+    root->setLeft(left);
+    if (left != NULL) {
+        left->setParent(root);
+    }
+    root->setRight(buildSubtree(next, count - leftCount - 1, root));
+    updateSize(root);
+    return root;
+}
+
+/**
+* Returns the number of items in the tree in O(1). Only available when the NodeType keeps subtree sizes.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::size_t BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::size() const
+{
+    static_assert(HAS_SIZES, "size() needs a NodeType derived from SizedNode");
+    return subtreeSize(static_cast<NodeType*>(mRoot));
+}
+
+/**
+* Returns an iterator to the item with the given zero based index in sorted order, or the end iterator if the
+* index is not smaller than size(). Takes one walk down the tree using the subtree sizes.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::iterator BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::select(std::size_t index) const
+{
+    static_assert(HAS_SIZES, "select() needs a NodeType derived from SizedNode");
+    auto root = static_cast<NodeType*>(mRoot);
+    while (root != NULL) {
+        std::size_t leftSize = subtreeSize(root->getLeft());
+        if (index < leftSize) {
+            root = root->getLeft();
+        } else if (index == leftSize) {
+            break;
+        } else {
+            index -= leftSize + 1;
+            root = root->getRight();
+        }
+    }
+    return iterator(root);
+}
+
+/**
+* Returns the number of keys in the tree that are smaller than the given key, which is also the index the key has
+* or would have in sorted order. Takes one walk down the tree using the subtree sizes.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::size_t BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rank(const Key& key) const
+{
+    static_assert(HAS_SIZES, "rank() needs a NodeType derived from SizedNode");
+    std::size_t smaller = 0;
+    auto root = static_cast<NodeType*>(mRoot);
+    while (root != NULL) {
+        if (mCompare(root->getKey(), key)) {
+            // The root and its whole left subtree are smaller
+            smaller += subtreeSize(root->getLeft()) + 1;
+            root = root->getRight();
+        } else {
+            root = root->getLeft();
+        }
+    }
+    return smaller;
+}
+
+/**
+* Recomputes the subtree size of a single Node from its children, if the Nodes keep sizes at all.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::updateSize(Node<Key, Value>* node)
+{
+    updateSubtreeSize(static_cast<NodeType*>(node));
+}
+
+/**
+* Recomputes the subtree sizes from a Node up to the root of its tree, after a Node below it was added or removed.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::updateSizesUpwards(Node<Key, Value>* node)
+{
+    if (!HAS_SIZES) {
+        return;
+    }
+    while (node != NULL) {
+        updateSize(node);
+        node = node->getParent();
+    }
+}
+
+/**
+* Sorts a batch of pairs by key and removes duplicate keys, keeping the last pair given for each key so that a
+* batch behaves like inserting its pairs one after another.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::sortBatch(std::vector<std::pair<Key, Value> >& items) const
+{
+    std::stable_sort(items.begin(), items.end(),
+                     [this](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) { return mCompare(a.first, b.first); });
+    std::size_t unique = 0;
+    for (std::size_t i = 0; i < items.size(); i++) {
+        if (unique != 0 && !mCompare(items[unique - 1].first, items[i].first)) {
+            items[unique - 1] = items[i];
+        } else {
+            items[unique++] = items[i];
+        }
+    }
+    items.erase(items.begin() + unique, items.end());
+}
+
+/**
+* Sorts a batch of keys and removes duplicates.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::sortKeys(std::vector<Key>& keys) const
+{
+    std::sort(keys.begin(), keys.end(), mCompare);
+    std::size_t unique = 0;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        if (unique == 0 || mCompare(keys[unique - 1], keys[i])) {
+            keys[unique++] = keys[i];
+        }
+    }
+    keys.erase(keys.begin() + unique, keys.end());
+}
+
+/**
+* A method to remove all contents of the tree and reset the values in the tree
+* for use again. Takes O(n) time and constant extra space, however deep the tree is.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::clear()
+{
+    // If the items need no destructor, an arena allocator can drop all of the Nodes at once with its chunks
+    if (std::is_trivially_destructible<std::pair<Key, Value> >::value && mAlloc.releaseAll()) {
+        mRoot = NULL;
+        return;
+    }
+    deleteTree(mRoot);
+    mAlloc.releaseAll();    // Hands the now empty chunks of an arena back as well
+    mRoot = NULL;
+}
+
+/**
+* A helper function used to delete every Node of a subtree. Uses constant extra space, see freeSubtree().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::deleteTree(Node<Key, Value>* root)
+{
+    freeSubtree(root, mAlloc);
+}
+
+
+
+/**
+* Creates a Node of the tree's NodeType in memory from the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+NodeType* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return emplaceNode(parent, key, value);
+}
+
+/**
+* Creates a Node of the tree's NodeType from the allocator, building its item in place from the arguments the
+* same way a std::pair would be built from them.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename... Args>
+NodeType* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::emplaceNode(Node<Key, Value>* parent, Args&&... args)
+{
+    NodeType* memory = mAlloc.allocate();
+    try {
+        return new (memory) NodeType(static_cast<NodeType*>(parent), std::forward<Args>(args)...);
+    } catch (...) {
+        mAlloc.deallocate(memory);
+        throw;
+    }
+}
+
+/**
+* Destroys a Node and gives its memory back to the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::destroyNode(Node<Key, Value>* node)
+{
+    NodeType* typedNode = static_cast<NodeType*>(node);
+    typedNode->~NodeType();
+    mAlloc.deallocate(typedNode);
+}
+
+/**
+* A helper function to find the largest node in the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::getLargestNode(Node<Key, Value>* root) const
+{
+    // Keep going on the right side until you reach the rightmost Node aka the largest Node
+    while (root->getRight() != NULL) {
+        root = root->getRight();
+    }
+    return root;
+}
+
+/**
+* A helper function to find the smallest node in the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::getSmallestNode() const
+{
+    // Keep going on the left side until you reach the leftmost Node aka the smallest Node
+    auto smallest = mRoot;
+	while (smallest != NULL && smallest->getLeft() != NULL) {
+	    smallest = smallest->getLeft();
+	}
+	return smallest;
+}
+
+
+/**
+* Helper function to find a node with given key, k and
+* return a pointer to it or NULL if no item with that key
+* exists
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::internalFind(const Key& key) const
+{
+    return findNode(key);
+}
+
+/**
+* Returns a copy of the Compare that orders the keys.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Compare BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::key_comp() const
+{
+    return mCompare;
+}
+
+/**
+* Orders two keys, or a key and anything the Compare can compare it with, returning a negative number, zero or a
+* positive number. Takes a single <=> where KeyOrder allows it. See KeyOrder.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::compareKeys(const A& a, const B& b) const
+{
+    return KeyOrder<Compare>::compare(mCompare, a, b);
+}
+
+/**
+* Rebalances the tree in place with the Day-Stout-Warren algorithm: rotates it right into a vine (a linked list
+* down right children), and then folds the vine in half with left rotations until it is as balanced as it can be,
+* with every level full except perhaps the last. Takes O(n) time and O(1) extra space, and allocates nothing, so a
+* tree loaded from sorted input can be fixed once before it is searched.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rebalance()
+{
+    // Rotate every left child up onto the right spine, counting the Nodes as they land there
+    std::size_t count = 0;
+    Node<Key, Value>* spine = mRoot;
+    while (spine != NULL) {
+        if (spine->getLeft() != NULL) {
+            rightRotate(spine);
+            spine = spine->getParent();
+        } else {
+            count++;
+            spine = spine->getRight();
+        }
+    }
+
+    // The Nodes past the largest perfect tree that fits go to the bottom level first
+    std::size_t perfect = 0;
+    while (perfect * 2 + 1 <= count) {
+        perfect = perfect * 2 + 1;
+    }
+    compressVine(count - perfect);
+    while (perfect > 1) {
+        perfect /= 2;
+        compressVine(perfect);
+    }
+}
+
+/**
+* A helper function for rebalance() that rotates left at every other Node down the right spine, count times, so
+* that each rotated Node becomes the left child of the one after it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::compressVine(std::size_t count)
+{
+    Node<Key, Value>* spine = mRoot;
+    for (std::size_t i = 0; i < count; i++) {
+        leftRotate(spine);
+        spine = spine->getParent()->getRight();
+    }
+}
+
+/**
+* Rotates the tree to the right from a root Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rightRotate(Node<Key, Value>* r)
+{
+    rightRotate(r, mRoot);
+}
+
+/**
+* Rotates to the right from a Node, where root is the pointer to update if the Node is the root of the tree. A
+* caller that knows the Node is not the root can pass a pointer of its own, so the tree's root is left untouched.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::rightRotate(Node<Key, Value>* r, Node<Key, Value>*& root)
+{
+    // If the left side is empty, no rotation
+    if (r->getLeft() == NULL) {
+        return;
+    }
+
+    // Finding the three key players in the rotation
+    auto leftChild = r->getLeft();
+    auto leftRightChild = leftChild->getRight();
+    auto parent = r->getParent();
+
+    // Changing the Pointers accordingly
+    r->setLeft(leftRightChild);         // leftRightChild becomes the child of the root instead of leftChild
+    r->setParent(leftChild);            // leftChild becomes the parent of the root instead of being the left child
+    leftChild->setRight(r);             // root becomes the right child of the leftChild
+    leftChild->setParent(parent);       // root's parent becomes the parent of the leftChild instead of root
+
+    // Changing the main root if necessary
+    if (r == root) {
+        root = leftChild;
+    }
+    // If the leftRightChild exists, set its parent to the root
+    if (leftRightChild != NULL) {
+        leftRightChild->setParent(r);
+    }
+    // If the root has a parent, then set the parent's new left or right child
+    if (parent != NULL){
+        if (parent->getLeft() == r) {
+            parent->setLeft(leftChild);
+        } else {
+            parent->setRight(leftChild);
+        }
+    }
+    // Only the two rotated Nodes have different subtrees now
+    updateSize(r);
+    updateSize(leftChild);
+}
+
+/**
+* Rotates the tree to the left from a root Node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::leftRotate(Node<Key, Value>* r)
+{
+    leftRotate(r, mRoot);
+}
+
+/**
+* Rotates to the left from a Node, where root is the pointer to update if the Node is the root of the tree. See
+* rightRotate().
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::leftRotate(Node<Key, Value>* r, Node<Key, Value>*& root)
+{
+    // If the right side is empty, no rotation
+    if (r->getRight() == NULL) {
+        return;
+    }
+
+    // Finding the three key players in the rotation
+    auto rightChild = r->getRight();
+    auto rightLeftChild = rightChild->getLeft();
+    auto parent = r->getParent();
+
+    // Changing the Pointers accordingly
+    r->setRight(rightLeftChild);        // rightLeftChild becomes the right child of root, replacing rightChild
+    r->setParent(rightChild);           // rightChild becomes the parent of root, replacing parent
+    rightChild->setLeft(r);             // root becomes the left child of rightChild, replacing rightLeftChild
+    rightChild->setParent(parent);      // parent becomes the parent of rightChild, replacing root
+
+    // Changing the main root if necessary
+    if (r == root) {
+        root = rightChild;
+    }
+
+    // If the rightLeftChild exists, set its parent to the root
+    if (rightLeftChild != NULL) {
+        rightLeftChild->setParent(r);
+    }
+    // If the root has a parent, then set the parent's new left or right child
+    if (parent != NULL){
+        if (parent->getLeft() == r) {
+            parent->setLeft(rightChild);
+        } else {
+            parent->setRight(rightChild);
+        }
+    }
+    // Only the two rotated Nodes have different subtrees now
+    updateSize(r);
+    updateSize(rightChild);
+}
+
+
+/**
+ * Return true iff the BST is an AVL Tree.
+ */
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::isBalanced() const
+{
+    return balanceFactor(mRoot);
+}
+
+/**
+ * Returns true if the balance factor is less than or equal to 1, AKA is balanced, at every Node below the root.
+ * Works through the tree bottom up with an explicit stack instead of recursion, so it takes O(n) time and never
+ * runs out of call stack on a degenerate tree.
+ */
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::balanceFactor(Node<Key, Value>* root) const
+{
+    // Each Node is visited twice: once to queue its children, and once more after both of their heights are known
+    struct Visit {
+        Node<Key, Value>* node;
+        bool childrenDone;
+    };
+    std::vector<Visit> work(1, Visit{root, false});
+    std::vector<int> heights;
+    while (!work.empty()) {
+        Visit visit = work.back();
+        work.pop_back();
+        // If we reach a NULL node, its height is 0
+        if (visit.node == NULL) {
+            heights.push_back(0);
+        } else if (!visit.childrenDone) {
+            work.push_back(Visit{visit.node, true});
+            work.push_back(Visit{visit.node->getRight(), false});
+            work.push_back(Visit{visit.node->getLeft(), false});
+        } else {
+            // The left subtree was finished first, so its height is below the right one's
+            int rightHeight = heights.back();
+            heights.pop_back();
+            int leftHeight = heights.back();
+            heights.pop_back();
+            if (abs(rightHeight - leftHeight) > 1) {
+                return false;
+            }
+            heights.push_back(std::max(leftHeight, rightHeight) + 1);
+        }
+    }
+    return true;
+}
+
+/**
+ * A print function for debugging. Just call it with a node to start printing at, e.g:
+   this->printRoot(this->mRoot)
+   It will print up to 5 levels of the tree rooted at the passed node sideways, with the right subtree on top.
+  */
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::printRoot(Node<Key, Value>* root) const
+{
+    printLevels(root, 0);
+}
+
+/**
+ * Recursive helper for printRoot that prints one Node per line, indented by its depth.
+ */
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+void BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::printLevels(Node<Key, Value>* root, int depth) const
+{
+    if (root == NULL || depth >= 5) {
+        return;
+    }
+    printLevels(root->getRight(), depth + 1);
+    std::cout << std::string(4 * depth, ' ') << root->getKey() << "\n";
+    printLevels(root->getLeft(), depth + 1);
+}
+
+/**
+* An unbalanced binary search tree that keeps subtree sizes for size(), select() and rank().
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>, template <typename> class Allocator = NodeAllocator>
+using OrderStatisticsBST = BinarySearchTree<Key, Value, Compare, Allocator, SizedNode<Key, Value> >;
+
+#include "rotateBST.h"
+
+/*
+	---------------------------------------------------
+	End implementations for the BinarySearchTree class.
+	---------------------------------------------------
+*/
+
+#endif
+
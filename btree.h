@@ -0,0 +1,872 @@
+//
+// A cache conscious B+ tree with the same interface as the binary search trees in bst.h.
+//
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <iostream>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "nodealloc.h"
+
+/**
+* A templated B+ tree. Inner nodes hold only keys and child pointers, every item lives in a leaf, and the leaves
+* are linked in key order, so that iterating is a walk along arrays instead of up and down a tree. Nodes are sized
+* to a few cache lines, which makes the tree about log(64) n levels deep instead of log(2) n, and a lookup reads
+* a handful of nodes with each key search staying inside one of them.
+*
+* It can be used in place of a BinarySearchTree or an AVLTree with insert(), remove(), find(), begin() and end().
+* Unlike them it keeps items in arrays, so Key and Value have to be default constructible and move assignable,
+* and inserting or removing an item invalidates every iterator into the same leaf.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator>
+class BTree
+{
+private:
+    // The byte budget for one node, four cache lines
+    static const std::size_t NODE_BYTES = 256;
+    static const std::size_t LEAF_SLOTS = (NODE_BYTES / sizeof(std::pair<Key, Value>) < 4) ? 4 : NODE_BYTES / sizeof(std::pair<Key, Value>);
+    static const std::size_t INNER_SLOTS = (NODE_BYTES / (sizeof(Key) + sizeof(void*)) < 4) ? 4 : NODE_BYTES / (sizeof(Key) + sizeof(void*));
+    // A node other than the root is never left with fewer keys than this
+    static const std::size_t MIN_LEAF = LEAF_SLOTS / 2;
+    static const std::size_t MIN_INNER = INNER_SLOTS / 2;
+    // The deepest a tree can get, since every inner node but the root has at least two children
+    static const std::size_t MAX_HEIGHT = 64;
+
+    struct BaseNode
+    {
+        std::size_t mCount;
+    };
+
+    // A leaf holds mCount items, and knows its neighbours for iteration
+    struct LeafNode : BaseNode
+    {
+        LeafNode* mPrev;
+        LeafNode* mNext;
+        std::pair<Key, Value> mItems[LEAF_SLOTS];
+    };
+
+    // An inner node holds mCount keys and mCount + 1 children. Every key in mChildren[i] is at least mKeys[i - 1]
+    // and smaller than mKeys[i].
+    struct InnerNode : BaseNode
+    {
+        Key mKeys[INNER_SLOTS];
+        BaseNode* mChildren[INNER_SLOTS + 1];
+    };
+
+    // The inner nodes passed on the way down to a leaf, with the index of the child that was taken
+    struct PathStep
+    {
+        InnerNode* node;
+        std::size_t child;
+    };
+
+public:
+    BTree();
+    explicit BTree(const Compare& compare);
+    BTree(const BTree& other) = delete;
+    BTree& operator=(const BTree& other) = delete;
+    ~BTree();
+    void insert(const std::pair<Key, Value>& keyValuePair);
+    void insert(std::pair<Key, Value>&& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    void print() const;
+    std::size_t size() const;
+    Compare key_comp() const;
+
+    /**
+    * An iterator for traversing the contents of the BTree in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<Key, Value>* pointer;
+        typedef std::pair<Key, Value>& reference;
+
+        iterator();
+
+        std::pair<Key, Value>& operator*() const;
+        std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        iterator(LeafNode* leaf, std::size_t index);
+
+        LeafNode* mLeaf;
+        std::size_t mIndex;
+
+        friend class BTree<Key, Value, Compare, Allocator>;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+
+private:
+    template <typename Pair>
+    void insertItem(Pair&& keyValuePair);
+    LeafNode* findLeaf(const Key& key, PathStep* path) const;
+    iterator leafPosition(LeafNode* leaf, std::size_t index) const;
+    std::size_t childIndex(const InnerNode* node, const Key& key) const;
+    std::size_t itemIndex(const LeafNode* leaf, const Key& key) const;
+    std::size_t upperItemIndex(const LeafNode* leaf, const Key& key) const;
+    void splitLeaf(LeafNode* leaf, std::size_t index, PathStep* path, std::size_t depth);
+    void insertIntoInner(Key&& key, BaseNode* right, PathStep* path, std::size_t depth);
+    void fixLeaf(LeafNode* leaf, PathStep* path, std::size_t depth);
+    void fixInner(InnerNode* node, PathStep* path, std::size_t depth);
+    void removeChild(InnerNode* parent, std::size_t key);
+    LeafNode* createLeaf();
+    InnerNode* createInner();
+    void destroyLeaf(LeafNode* leaf);
+    void destroyInner(InnerNode* node);
+
+    // A linear scan compiles to branch free (and for built-in keys vectorized) compares, which beats a binary
+    // search inside a node of a few cache lines. Keys with an expensive compare are searched in O(log) compares.
+    static const bool LINEAR_SEARCH = std::is_arithmetic<Key>::value;
+
+    BaseNode* mRoot;
+    // The number of levels, so that a walk down knows when it reaches the leaves, or 0 for an empty tree
+    std::size_t mHeight;
+    std::size_t mSize;
+    LeafNode* mFirstLeaf;
+    Compare mCompare;
+    Allocator<LeafNode> mLeafAlloc;
+    Allocator<InnerNode> mInnerAlloc;
+};
+
+/*
+	------------------------------------------------------
+	Begin implementations for the BTree::iterator class.
+	------------------------------------------------------
+*/
+
+/**
+* A default constructor that initializes the iterator to the end.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+BTree<Key, Value, Compare, Allocator>::iterator::iterator()
+        : mLeaf(NULL)
+        , mIndex(0)
+{
+
+}
+
+/**
+* Constructor for an iterator at an item of a leaf. A NULL leaf is the end.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+BTree<Key, Value, Compare, Allocator>::iterator::iterator(LeafNode* leaf, std::size_t index)
+        : mLeaf(leaf)
+        , mIndex(index)
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::pair<Key, Value>& BTree<Key, Value, Compare, Allocator>::iterator::operator*() const
+{
+    return mLeaf->mItems[mIndex];
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::pair<Key, Value>* BTree<Key, Value, Compare, Allocator>::iterator::operator->() const
+{
+    return &(mLeaf->mItems[mIndex]);
+}
+
+/**
+* Checks if two iterators point at the same item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool BTree<Key, Value, Compare, Allocator>::iterator::operator==(const iterator& rhs) const
+{
+    return mLeaf == rhs.mLeaf && mIndex == rhs.mIndex;
+}
+
+/**
+* Checks if two iterators point at different items.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool BTree<Key, Value, Compare, Allocator>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator to the next item of the leaf, or to the first item of the next leaf.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator& BTree<Key, Value, Compare, Allocator>::iterator::operator++()
+{
+    mIndex++;
+    if (mIndex == mLeaf->mCount) {
+        mLeaf = mLeaf->mNext;
+        mIndex = 0;
+    }
+    return *this;
+}
+
+/*
+	----------------------------------------------------
+	End implementations for the BTree::iterator class.
+	----------------------------------------------------
+*/
+
+/*
+	-----------------------------------------
+	Begin implementations for the BTree class.
+	-----------------------------------------
+*/
+
+/**
+* Default constructor for an empty BTree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+BTree<Key, Value, Compare, Allocator>::BTree()
+        : mRoot(NULL)
+        , mHeight(0)
+        , mSize(0)
+        , mFirstLeaf(NULL)
+        , mCompare()
+{
+
+}
+
+/**
+* Constructor for an empty BTree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+BTree<Key, Value, Compare, Allocator>::BTree(const Compare& compare)
+        : mRoot(NULL)
+        , mHeight(0)
+        , mSize(0)
+        , mFirstLeaf(NULL)
+        , mCompare(compare)
+{
+
+}
+
+/**
+* Destructor, which frees every node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+BTree<Key, Value, Compare, Allocator>::~BTree()
+{
+    clear();
+}
+
+/**
+* Inserts a key-value pair, overwriting the value if the key is already in the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    insertItem(keyValuePair);
+}
+
+/**
+* Inserts a key-value pair like insert(const std::pair&), moving the key and the value into the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::insert(std::pair<Key, Value>&& keyValuePair)
+{
+    insertItem(std::move(keyValuePair));
+}
+
+/**
+* A helper function for both insert() overloads. The item goes into its leaf, and a full leaf is split in two,
+* which may in turn split the inner nodes above it, up to a new root.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename Pair>
+void BTree<Key, Value, Compare, Allocator>::insertItem(Pair&& keyValuePair)
+{
+    if (mRoot == NULL) {
+        auto leaf = createLeaf();
+        leaf->mItems[0] = std::forward<Pair>(keyValuePair);
+        leaf->mCount = 1;
+        mRoot = leaf;
+        mFirstLeaf = leaf;
+        mHeight = 1;
+        mSize = 1;
+        return;
+    }
+
+    PathStep path[MAX_HEIGHT];
+    auto leaf = findLeaf(keyValuePair.first, path);
+    std::size_t index = itemIndex(leaf, keyValuePair.first);
+    // If the key is already in the tree, override the current value
+    if (index < leaf->mCount && !mCompare(keyValuePair.first, leaf->mItems[index].first)) {
+        leaf->mItems[index].second = std::forward<Pair>(keyValuePair).second;
+        return;
+    }
+
+    if (leaf->mCount == LEAF_SLOTS) {
+        // Making room at index in whichever half of the split the item belongs to
+        splitLeaf(leaf, index, path, mHeight - 1);
+        if (index > leaf->mCount) {
+            index -= leaf->mCount;
+            leaf = leaf->mNext;
+        }
+    }
+    std::move_backward(leaf->mItems + index, leaf->mItems + leaf->mCount, leaf->mItems + leaf->mCount + 1);
+    leaf->mItems[index] = std::forward<Pair>(keyValuePair);
+    leaf->mCount++;
+    mSize++;
+}
+
+/**
+* Removes the item with the given key, if there is one. A leaf that drops below half full borrows an item from a
+* neighbour or is merged into one, which may leave the inner nodes above it short in turn.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::remove(const Key& key)
+{
+    if (mRoot == NULL) {
+        return;
+    }
+    PathStep path[MAX_HEIGHT];
+    auto leaf = findLeaf(key, path);
+    std::size_t index = itemIndex(leaf, key);
+    if (index == leaf->mCount || mCompare(key, leaf->mItems[index].first)) {
+        return;
+    }
+
+    std::move(leaf->mItems + index + 1, leaf->mItems + leaf->mCount, leaf->mItems + index);
+    leaf->mCount--;
+    leaf->mItems[leaf->mCount] = std::pair<Key, Value>();    // Lets go of whatever the last slot still held
+    mSize--;
+    fixLeaf(leaf, path, mHeight - 1);
+}
+
+/**
+* Frees every node, one level at a time from the root down, so no walk goes deeper than the tree's height.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::clear()
+{
+    if (mRoot == NULL) {
+        return;
+    }
+    std::vector<BaseNode*> level(1, mRoot);
+    for (std::size_t depth = 0; depth + 1 < mHeight; depth++) {
+        std::vector<BaseNode*> below;
+        for (auto node : level) {
+            auto inner = static_cast<InnerNode*>(node);
+            below.insert(below.end(), inner->mChildren, inner->mChildren + inner->mCount + 1);
+            destroyInner(inner);
+        }
+        level.swap(below);
+    }
+    for (auto node : level) {
+        destroyLeaf(static_cast<LeafNode*>(node));
+    }
+    mLeafAlloc.releaseAll();
+    mInnerAlloc.releaseAll();
+    mRoot = NULL;
+    mFirstLeaf = NULL;
+    mHeight = 0;
+    mSize = 0;
+}
+
+/**
+* Prints the keys of every node, one level of the tree per line.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::print() const
+{
+    if (mRoot == NULL) {
+        std::cout << "\n";
+        return;
+    }
+    std::vector<BaseNode*> level(1, mRoot);
+    for (std::size_t depth = 0; depth + 1 < mHeight; depth++) {
+        std::vector<BaseNode*> below;
+        for (auto node : level) {
+            auto inner = static_cast<InnerNode*>(node);
+            std::cout << "[";
+            for (std::size_t i = 0; i < inner->mCount; i++) {
+                std::cout << (i == 0 ? "" : " ") << inner->mKeys[i];
+            }
+            std::cout << "] ";
+            below.insert(below.end(), inner->mChildren, inner->mChildren + inner->mCount + 1);
+        }
+        std::cout << "\n";
+        level.swap(below);
+    }
+    for (auto leaf = mFirstLeaf; leaf != NULL; leaf = leaf->mNext) {
+        std::cout << "[";
+        for (std::size_t i = 0; i < leaf->mCount; i++) {
+            std::cout << (i == 0 ? "" : " ") << leaf->mItems[i].first;
+        }
+        std::cout << "] ";
+    }
+    std::cout << "\n";
+}
+
+/**
+* Returns the number of items, which the BTree keeps count of.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t BTree<Key, Value, Compare, Allocator>::size() const
+{
+    return mSize;
+}
+
+/**
+* Returns a copy of the Compare that orders the keys.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+Compare BTree<Key, Value, Compare, Allocator>::key_comp() const
+{
+    return mCompare;
+}
+
+/**
+* Returns an iterator to the item with the smallest key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::begin() const
+{
+    return iterator(mFirstLeaf, 0);
+}
+
+/**
+* Returns the iterator past the largest key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or the end iterator if there is none.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::find(const Key& key) const
+{
+    if (mRoot == NULL) {
+        return end();
+    }
+    auto leaf = findLeaf(key, NULL);
+    std::size_t index = itemIndex(leaf, key);
+    if (index == leaf->mCount || mCompare(key, leaf->mItems[index].first)) {
+        return end();
+    }
+    return iterator(leaf, index);
+}
+
+/**
+* Returns an iterator to the first item whose key is not smaller than the given key, or the end iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::lower_bound(const Key& key) const
+{
+    if (mRoot == NULL) {
+        return end();
+    }
+    auto leaf = findLeaf(key, NULL);
+    return leafPosition(leaf, itemIndex(leaf, key));
+}
+
+/**
+* Returns an iterator to the first item whose key is larger than the given key, or the end iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::upper_bound(const Key& key) const
+{
+    if (mRoot == NULL) {
+        return end();
+    }
+    auto leaf = findLeaf(key, NULL);
+    return leafPosition(leaf, upperItemIndex(leaf, key));
+}
+
+/**
+* A helper function that walks down to the leaf whose key range holds the given key. If path is not NULL, it
+* receives each inner node on the way along with the child that was taken, for the changes made on the way back up.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::LeafNode* BTree<Key, Value, Compare, Allocator>::findLeaf(const Key& key, PathStep* path) const
+{
+    auto node = mRoot;
+    for (std::size_t depth = 0; depth + 1 < mHeight; depth++) {
+        auto inner = static_cast<InnerNode*>(node);
+        std::size_t child = childIndex(inner, key);
+        if (path != NULL) {
+            path[depth].node = inner;
+            path[depth].child = child;
+        }
+        node = inner->mChildren[child];
+    }
+    return static_cast<LeafNode*>(node);
+}
+
+/**
+* A helper function that turns an index into a leaf into an iterator, moving on to the next leaf if the index is
+* past the leaf's last item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::iterator BTree<Key, Value, Compare, Allocator>::leafPosition(LeafNode* leaf, std::size_t index) const
+{
+    if (index == leaf->mCount) {
+        return iterator(leaf->mNext, 0);
+    }
+    return iterator(leaf, index);
+}
+
+/**
+* A helper function that returns which child of an inner node the given key belongs under, which is the number
+* of the node's keys that are not larger than it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t BTree<Key, Value, Compare, Allocator>::childIndex(const InnerNode* node, const Key& key) const
+{
+    if (LINEAR_SEARCH) {
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < node->mCount; i++) {
+            index += !mCompare(key, node->mKeys[i]);
+        }
+        return index;
+    }
+    return std::upper_bound(node->mKeys, node->mKeys + node->mCount, key, mCompare) - node->mKeys;
+}
+
+/**
+* A helper function that returns the index of the first item of a leaf whose key is not smaller than the given
+* key, or the leaf's count if there is none.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t BTree<Key, Value, Compare, Allocator>::itemIndex(const LeafNode* leaf, const Key& key) const
+{
+    if (LINEAR_SEARCH) {
+        std::size_t index = 0;
+        for (std::size_t i = 0; i < leaf->mCount; i++) {
+            index += mCompare(leaf->mItems[i].first, key);
+        }
+        return index;
+    }
+    auto found = std::lower_bound(leaf->mItems, leaf->mItems + leaf->mCount, key,
+                                  [this](const std::pair<Key, Value>& item, const Key& k) { return mCompare(item.first, k); });
+    return found - leaf->mItems;
+}
+
+/**
+* A helper function that returns the index of the first item of a leaf whose key is larger than the given key,
+* or the leaf's count if there is none.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t BTree<Key, Value, Compare, Allocator>::upperItemIndex(const LeafNode* leaf, const Key& key) const
+{
+    std::size_t index = itemIndex(leaf, key);
+    if (index < leaf->mCount && !mCompare(key, leaf->mItems[index].first)) {
+        index++;
+    }
+    return index;
+}
+
+/**
+* A helper function that splits a full leaf in two, so that the item about to be inserted at index fits. An item
+* that would become the first one of the right leaf goes to the end of the left leaf instead, so the right leaf's
+* first key, which it is hung into the parent under, stays its smallest.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::splitLeaf(LeafNode* leaf, std::size_t index, PathStep* path, std::size_t depth)
+{
+    auto right = createLeaf();
+    std::size_t leftCount = (LEAF_SLOTS + 1) / 2;
+    if (index < leftCount) {
+        leftCount--;
+    }
+    std::move(leaf->mItems + leftCount, leaf->mItems + LEAF_SLOTS, right->mItems);
+    right->mCount = LEAF_SLOTS - leftCount;
+    leaf->mCount = leftCount;
+
+    right->mNext = leaf->mNext;
+    right->mPrev = leaf;
+    if (leaf->mNext != NULL) {
+        leaf->mNext->mPrev = right;
+    }
+    leaf->mNext = right;
+
+    insertIntoInner(Key(right->mItems[0].first), right, path, depth);
+}
+
+/**
+* A helper function that adds a key and the child to its right to the inner node at path[depth - 1], splitting
+* that node if it is full, and so on upwards. At depth 0 the tree grows a new root.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::insertIntoInner(Key&& key, BaseNode* right, PathStep* path, std::size_t depth)
+{
+    while (depth > 0) {
+        auto node = path[depth - 1].node;
+        std::size_t index = path[depth - 1].child;
+        if (node->mCount < INNER_SLOTS) {
+            std::move_backward(node->mKeys + index, node->mKeys + node->mCount, node->mKeys + node->mCount + 1);
+            std::move_backward(node->mChildren + index + 1, node->mChildren + node->mCount + 1, node->mChildren + node->mCount + 2);
+            node->mKeys[index] = std::move(key);
+            node->mChildren[index + 1] = right;
+            node->mCount++;
+            return;
+        }
+
+        // Lining up the keys and children with the new ones in place, then moving the middle key up
+        Key keys[INNER_SLOTS + 1];
+        BaseNode* children[INNER_SLOTS + 2];
+        std::move(node->mKeys, node->mKeys + index, keys);
+        keys[index] = std::move(key);
+        std::move(node->mKeys + index, node->mKeys + INNER_SLOTS, keys + index + 1);
+        std::copy(node->mChildren, node->mChildren + index + 1, children);
+        children[index + 1] = right;
+        std::copy(node->mChildren + index + 1, node->mChildren + INNER_SLOTS + 1, children + index + 2);
+
+        auto sibling = createInner();
+        std::size_t leftCount = (INNER_SLOTS + 1) / 2;
+        std::move(keys, keys + leftCount, node->mKeys);
+        std::copy(children, children + leftCount + 1, node->mChildren);
+        node->mCount = leftCount;
+        std::move(keys + leftCount + 1, keys + INNER_SLOTS + 1, sibling->mKeys);
+        std::copy(children + leftCount + 1, children + INNER_SLOTS + 2, sibling->mChildren);
+        sibling->mCount = INNER_SLOTS - leftCount;
+        for (std::size_t i = leftCount; i < INNER_SLOTS; i++) {
+            node->mKeys[i] = Key();
+        }
+
+        key = std::move(keys[leftCount]);
+        right = sibling;
+        depth--;
+    }
+
+    auto root = createInner();
+    root->mKeys[0] = std::move(key);
+    root->mChildren[0] = mRoot;
+    root->mChildren[1] = right;
+    root->mCount = 1;
+    mRoot = root;
+    mHeight++;
+}
+
+/**
+* A helper function that refills a leaf at the given depth that has dropped below half full, first by borrowing
+* an item from a neighbour with items to spare, otherwise by merging it with one.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::fixLeaf(LeafNode* leaf, PathStep* path, std::size_t depth)
+{
+    if (depth == 0) {
+        // The root leaf may hold any number of items, and goes away with the last one
+        if (leaf->mCount == 0) {
+            destroyLeaf(leaf);
+            mRoot = NULL;
+            mFirstLeaf = NULL;
+            mHeight = 0;
+        }
+        return;
+    }
+    if (leaf->mCount >= MIN_LEAF) {
+        return;
+    }
+
+    auto parent = path[depth - 1].node;
+    std::size_t index = path[depth - 1].child;
+    auto left = (index > 0) ? static_cast<LeafNode*>(parent->mChildren[index - 1]) : NULL;
+    auto right = (index < parent->mCount) ? static_cast<LeafNode*>(parent->mChildren[index + 1]) : NULL;
+
+    if (left != NULL && left->mCount > MIN_LEAF) {
+        std::move_backward(leaf->mItems, leaf->mItems + leaf->mCount, leaf->mItems + leaf->mCount + 1);
+        leaf->mItems[0] = std::move(left->mItems[left->mCount - 1]);
+        leaf->mCount++;
+        left->mCount--;
+        left->mItems[left->mCount] = std::pair<Key, Value>();
+        parent->mKeys[index - 1] = leaf->mItems[0].first;
+        return;
+    }
+    if (right != NULL && right->mCount > MIN_LEAF) {
+        leaf->mItems[leaf->mCount] = std::move(right->mItems[0]);
+        leaf->mCount++;
+        std::move(right->mItems + 1, right->mItems + right->mCount, right->mItems);
+        right->mCount--;
+        right->mItems[right->mCount] = std::pair<Key, Value>();
+        parent->mKeys[index] = right->mItems[0].first;
+        return;
+    }
+
+    // Neither neighbour can spare an item, so the leaf and one of them fit into one leaf together
+    if (left == NULL) {
+        left = leaf;
+        index++;
+    }
+    auto gone = static_cast<LeafNode*>(parent->mChildren[index]);
+    std::move(gone->mItems, gone->mItems + gone->mCount, left->mItems + left->mCount);
+    left->mCount += gone->mCount;
+    left->mNext = gone->mNext;
+    if (gone->mNext != NULL) {
+        gone->mNext->mPrev = left;
+    }
+    destroyLeaf(gone);
+    removeChild(parent, index - 1);
+    fixInner(parent, path, depth - 1);
+}
+
+/**
+* A helper function like fixLeaf() for an inner node at the given depth. Borrowing rotates a key through the
+* parent, and merging pulls the parent's key between the two nodes down into the merged one.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::fixInner(InnerNode* node, PathStep* path, std::size_t depth)
+{
+    while (depth > 0 && node->mCount < MIN_INNER) {
+        auto parent = path[depth - 1].node;
+        std::size_t index = path[depth - 1].child;
+        auto left = (index > 0) ? static_cast<InnerNode*>(parent->mChildren[index - 1]) : NULL;
+        auto right = (index < parent->mCount) ? static_cast<InnerNode*>(parent->mChildren[index + 1]) : NULL;
+
+        if (left != NULL && left->mCount > MIN_INNER) {
+            std::move_backward(node->mKeys, node->mKeys + node->mCount, node->mKeys + node->mCount + 1);
+            std::move_backward(node->mChildren, node->mChildren + node->mCount + 1, node->mChildren + node->mCount + 2);
+            node->mKeys[0] = std::move(parent->mKeys[index - 1]);
+            node->mChildren[0] = left->mChildren[left->mCount];
+            node->mCount++;
+            parent->mKeys[index - 1] = std::move(left->mKeys[left->mCount - 1]);
+            left->mCount--;
+            left->mKeys[left->mCount] = Key();
+            return;
+        }
+        if (right != NULL && right->mCount > MIN_INNER) {
+            node->mKeys[node->mCount] = std::move(parent->mKeys[index]);
+            node->mChildren[node->mCount + 1] = right->mChildren[0];
+            node->mCount++;
+            parent->mKeys[index] = std::move(right->mKeys[0]);
+            std::move(right->mKeys + 1, right->mKeys + right->mCount, right->mKeys);
+            std::copy(right->mChildren + 1, right->mChildren + right->mCount + 1, right->mChildren);
+            right->mCount--;
+            right->mKeys[right->mCount] = Key();
+            return;
+        }
+
+        if (left == NULL) {
+            left = node;
+            index++;
+        }
+        auto gone = static_cast<InnerNode*>(parent->mChildren[index]);
+        left->mKeys[left->mCount] = std::move(parent->mKeys[index - 1]);
+        std::move(gone->mKeys, gone->mKeys + gone->mCount, left->mKeys + left->mCount + 1);
+        std::copy(gone->mChildren, gone->mChildren + gone->mCount + 1, left->mChildren + left->mCount + 1);
+        left->mCount += gone->mCount + 1;
+        destroyInner(gone);
+        removeChild(parent, index - 1);
+
+        node = parent;
+        depth--;
+    }
+
+    // A root that is left with a single child hands the root over to it
+    if (depth == 0 && node->mCount == 0) {
+        mRoot = node->mChildren[0];
+        destroyInner(node);
+        mHeight--;
+    }
+}
+
+/**
+* A helper function that takes the key at the given index, and the child to its right, out of an inner node.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::removeChild(InnerNode* parent, std::size_t key)
+{
+    std::move(parent->mKeys + key + 1, parent->mKeys + parent->mCount, parent->mKeys + key);
+    std::copy(parent->mChildren + key + 2, parent->mChildren + parent->mCount + 1, parent->mChildren + key + 1);
+    parent->mCount--;
+    parent->mKeys[parent->mCount] = Key();
+}
+
+/**
+* A helper function that gets an empty leaf from the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::LeafNode* BTree<Key, Value, Compare, Allocator>::createLeaf()
+{
+    LeafNode* leaf = mLeafAlloc.allocate();
+    try {
+        new (leaf) LeafNode();
+    } catch (...) {
+        mLeafAlloc.deallocate(leaf);
+        throw;
+    }
+    leaf->mCount = 0;
+    leaf->mPrev = NULL;
+    leaf->mNext = NULL;
+    return leaf;
+}
+
+/**
+* A helper function that gets an empty inner node from the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename BTree<Key, Value, Compare, Allocator>::InnerNode* BTree<Key, Value, Compare, Allocator>::createInner()
+{
+    InnerNode* node = mInnerAlloc.allocate();
+    try {
+        new (node) InnerNode();
+    } catch (...) {
+        mInnerAlloc.deallocate(node);
+        throw;
+    }
+    node->mCount = 0;
+    return node;
+}
+
+/**
+* A helper function that destroys a leaf and gives it back to the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::destroyLeaf(LeafNode* leaf)
+{
+    leaf->~LeafNode();
+    mLeafAlloc.deallocate(leaf);
+}
+
+/**
+* A helper function that destroys an inner node and gives it back to the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void BTree<Key, Value, Compare, Allocator>::destroyInner(InnerNode* node)
+{
+    node->~InnerNode();
+    mInnerAlloc.deallocate(node);
+}
+
+/*
+	---------------------------------------
+	End implementations for the BTree class.
+	---------------------------------------
+*/
+
+#endif
@@ -0,0 +1,613 @@
+//
+// An AVL tree that many threads can insert into, remove from and search at the same time.
+//
+
+#ifndef CONCURRENTAVL_H
+#define CONCURRENTAVL_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* A reader-writer spin latch, small enough to put one in every Node. A writer that is waiting keeps new readers
+* out, so a stream of readers cannot starve it. Waiting threads yield after a short spin, since the holder may
+* not be running.
+*/
+class Latch
+{
+public:
+    Latch();
+
+    void lock();
+    void unlock();
+    void lockShared();
+    void unlockShared();
+
+private:
+    static void pause(unsigned& spins);
+
+    static const std::uint32_t EXCLUSIVE = 0x80000000u;
+    static const std::uint32_t WRITER_WAITING = 0x40000000u;
+    static const unsigned SPINS_BEFORE_YIELD = 16;
+
+    // The number of shared holders in the low bits, plus the two flags above
+    std::atomic<std::uint32_t> mState;
+};
+
+/**
+* A Node with a Latch, for trees that are changed by several threads at once.
+*/
+template <typename Key, typename Value>
+class LatchedNode : public Node<Key, Value>
+{
+public:
+    LatchedNode(const Key& key, const Value& value, LatchedNode<Key, Value>* parent);
+    template <typename... Args>
+    LatchedNode(LatchedNode<Key, Value>* parent, Args&&... args);
+
+    Latch& getLatch() const;
+
+private:
+    mutable Latch mLatch;
+};
+
+/**
+* An AVL tree whose insert(), remove() and find() may be called from any number of threads at once. Every Node has
+* a Latch, and an operation walks down holding the Latch of each Node until it holds the next one (latch
+* crabbing). Readers hold shared Latches, so they only ever wait for a writer working on the same Node.
+*
+* A writer holds its Latches exclusively, and keeps those of the Nodes that its rebalancing may still change. A
+* Node whose height cannot change, whatever happens below it, ends that part of the path: for an insert any Node
+* that leans to one side, and for a remove any Node that does not. Everything above its parent is let go, so
+* writers in different parts of the tree run side by side. Rotations are the ones from rotateBST, and a rotation
+* below the root is handed a root pointer of its own, so that only the writer holding the root's Latch ever
+* touches the tree's root.
+*
+* Everything else the tree inherits from AVLTree (iterators, batches, split and join, printing, clearing) is only
+* safe while no thread is inside insert(), remove() or find().
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator>
+class ConcurrentAVLTree : public AVLTree<Key, Value, Compare, Allocator, AVLNode<Key, Value, LatchedNode<Key, Value> > >
+{
+public:
+    typedef AVLNode<Key, Value, LatchedNode<Key, Value> > NodeType;
+    static_assert(Allocator<NodeType>::THREAD_SAFE, "ConcurrentAVLTree needs a thread safe allocator");
+
+    ConcurrentAVLTree();
+    explicit ConcurrentAVLTree(const Compare& compare);
+
+    void insert(const std::pair<Key, Value>& keyValuePair) override;
+    void remove(const Key& key) override;
+    bool find(const Key& key, Value& value) const;
+
+private:
+    void releaseAbove(std::vector<NodeType*>& path, bool& rootHeld);
+    void releaseAll(std::vector<NodeType*>& path, bool& rootHeld);
+    void retraceInsert(std::vector<NodeType*>& path, bool rootHeld);
+    void retraceRemove(std::vector<NodeType*>& path, bool rootHeld);
+    NodeType* rotateAt(NodeType* root, bool isRoot, bool latchChildren);
+    static int heightOf(NodeType* root);
+    static int balanceOf(NodeType* root);
+    static void updateHeight(NodeType* root);
+
+    // Guards the tree's root pointer, and acts as the Latch of the root's parent
+    mutable Latch mRootLatch;
+};
+
+/*
+	-----------------------------------------
+	Begin implementations for the Latch class.
+	-----------------------------------------
+*/
+
+/**
+* Constructor for a free Latch.
+*/
+inline Latch::Latch()
+        : mState(0)
+{
+
+}
+
+/**
+* Takes the Latch exclusively, once every other holder has let go of it.
+*/
+inline void Latch::lock()
+{
+    unsigned spins = 0;
+    while (true) {
+        std::uint32_t state = mState.load(std::memory_order_relaxed);
+        if ((state & ~WRITER_WAITING) == 0) {
+            if (mState.compare_exchange_weak(state, EXCLUSIVE, std::memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+        // Keeping new readers out until the ones inside are done
+        if ((state & WRITER_WAITING) == 0) {
+            mState.fetch_or(WRITER_WAITING, std::memory_order_relaxed);
+        }
+        pause(spins);
+    }
+}
+
+/**
+* Lets go of an exclusively held Latch. Another writer's waiting flag stays set.
+*/
+inline void Latch::unlock()
+{
+    mState.fetch_and(~EXCLUSIVE, std::memory_order_release);
+}
+
+/**
+* Takes the Latch shared with other readers, once no writer holds it or waits for it.
+*/
+inline void Latch::lockShared()
+{
+    unsigned spins = 0;
+    while (true) {
+        std::uint32_t state = mState.load(std::memory_order_relaxed);
+        if ((state & (EXCLUSIVE | WRITER_WAITING)) == 0) {
+            if (mState.compare_exchange_weak(state, state + 1, std::memory_order_acquire)) {
+                return;
+            }
+            continue;
+        }
+        pause(spins);
+    }
+}
+
+/**
+* Lets go of a shared Latch.
+*/
+inline void Latch::unlockShared()
+{
+    mState.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+* Waits a little before the next attempt, giving up the processor after a few tries.
+*/
+inline void Latch::pause(unsigned& spins)
+{
+    if (++spins >= SPINS_BEFORE_YIELD) {
+        spins = 0;
+        std::this_thread::yield();
+    }
+}
+
+/*
+	---------------------------------------
+	End implementations for the Latch class.
+	---------------------------------------
+*/
+
+/*
+	-----------------------------------------------
+	Begin implementations for the LatchedNode class.
+	-----------------------------------------------
+*/
+
+/**
+* Constructor for a LatchedNode, whose Latch starts out free.
+*/
+template<typename Key, typename Value>
+LatchedNode<Key, Value>::LatchedNode(const Key& key, const Value& value, LatchedNode<Key, Value>* parent)
+        : Node<Key, Value>(key, value, parent)
+{
+
+}
+
+/**
+* Constructor for a LatchedNode whose item is built in place from the given arguments.
+*/
+template<typename Key, typename Value>
+template<typename... Args>
+LatchedNode<Key, Value>::LatchedNode(LatchedNode<Key, Value>* parent, Args&&... args)
+        : Node<Key, Value>(parent, std::forward<Args>(args)...)
+{
+
+}
+
+/**
+* A getter for the Node's Latch, which can be taken even through a const Node.
+*/
+template<typename Key, typename Value>
+Latch& LatchedNode<Key, Value>::getLatch() const
+{
+    return mLatch;
+}
+
+/*
+	---------------------------------------------
+	End implementations for the LatchedNode class.
+	---------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the ConcurrentAVLTree class.
+	-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ConcurrentAVLTree<Key, Value, Compare, Allocator>::ConcurrentAVLTree()
+{
+
+}
+
+/**
+* Constructor for an empty tree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ConcurrentAVLTree<Key, Value, Compare, Allocator>::ConcurrentAVLTree(const Compare& compare)
+    : AVLTree<Key, Value, Compare, Allocator, NodeType>(compare)
+{
+
+}
+
+/**
+* Inserts a key-value pair, overwriting the value if the key is already in the tree. Safe to call from several
+* threads at once.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    std::vector<NodeType*> path;
+    bool rootHeld = true;
+    mRootLatch.lock();
+    auto node = static_cast<NodeType*>(this->mRoot);
+    if (node == NULL) {
+        try {
+            node = this->createNode(keyValuePair.first, keyValuePair.second, NULL);
+        } catch (...) {
+            mRootLatch.unlock();
+            throw;
+        }
+        node->setHeight(1);
+        this->mRoot = node;
+        mRootLatch.unlock();
+        return;
+    }
+    node->getLatch().lock();
+    path.push_back(node);
+
+    while (true) {
+        int order = this->compareKeys(keyValuePair.first, node->getKey());
+        if (order == 0) {
+            node->setValue(keyValuePair.second);
+            releaseAll(path, rootHeld);
+            return;
+        }
+        auto child = (order < 0) ? node->getLeft() : node->getRight();
+        if (child == NULL) {
+            break;
+        }
+        child->getLatch().lock();
+        // A leaning Node either absorbs a taller child or rotates back to its old height, so only it and its
+        // parent can still change
+        if (balanceOf(child) != 0) {
+            releaseAbove(path, rootHeld);
+        }
+        path.push_back(child);
+        node = child;
+    }
+
+    // Nobody else can reach the new leaf until its parent's Latch is let go
+    NodeType* newNode;
+    try {
+        newNode = this->createNode(keyValuePair.first, keyValuePair.second, node);
+    } catch (...) {
+        releaseAll(path, rootHeld);
+        throw;
+    }
+    newNode->setHeight(1);
+    if (this->compareKeys(keyValuePair.first, node->getKey()) < 0) {
+        node->setLeft(newNode);
+    } else {
+        node->setRight(newNode);
+    }
+    retraceInsert(path, rootHeld);
+    releaseAll(path, rootHeld);
+}
+
+/**
+* Removes the item with the given key, if there is one. Safe to call from several threads at once. A Node with two
+* children is replaced by its predecessor, so once the key is found the walk keeps every Latch down to it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::remove(const Key& key)
+{
+    std::vector<NodeType*> path;
+    bool rootHeld = true;
+    mRootLatch.lock();
+    auto node = static_cast<NodeType*>(this->mRoot);
+    if (node == NULL) {
+        mRootLatch.unlock();
+        return;
+    }
+    node->getLatch().lock();
+    path.push_back(node);
+
+    // Walking down to the Node with the key, then on to its predecessor if it has two children
+    std::size_t target = 0;
+    bool found = false;
+    while (true) {
+        NodeType* child;
+        if (!found) {
+            int order = this->compareKeys(key, node->getKey());
+            if (order == 0) {
+                found = true;
+                target = path.size() - 1;
+                if (node->getLeft() == NULL || node->getRight() == NULL) {
+                    break;
+                }
+                child = node->getLeft();
+            } else {
+                child = (order < 0) ? node->getLeft() : node->getRight();
+                if (child == NULL) {
+                    releaseAll(path, rootHeld);
+                    return;
+                }
+            }
+        } else {
+            child = node->getRight();
+            if (child == NULL) {
+                break;
+            }
+        }
+        child->getLatch().lock();
+        // A Node with two level subtrees keeps its height when one of them shrinks, even if it is the one removed
+        if (!found && balanceOf(child) == 0 && child->getLeft() != NULL) {
+            releaseAbove(path, rootHeld);
+            target = 0;
+        }
+        path.push_back(child);
+        node = child;
+    }
+
+    // The parent of a Node on the path is the one before it, or the root pointer, whose Latch is then held
+    auto removed = path[target];
+    auto parent = (target > 0) ? path[target - 1] : NULL;
+    NodeType* replacement;
+    if (path.size() - 1 == target) {
+        // Zero or one child, which simply moves up into the Node's place
+        replacement = (removed->getLeft() != NULL) ? removed->getLeft() : removed->getRight();
+        if (replacement != NULL) {
+            replacement->setParent(parent);
+        }
+        path.pop_back();
+    } else {
+        // Two children, so the largest Node on the left side is relinked into the Node's place
+        replacement = path.back();
+        auto largestParent = path[path.size() - 2];
+        if (largestParent != removed) {
+            largestParent->setRight(replacement->getLeft());
+            if (replacement->getLeft() != NULL) {
+                replacement->getLeft()->setParent(largestParent);
+            }
+            replacement->setLeft(removed->getLeft());
+            replacement->getLeft()->setParent(replacement);
+            path.pop_back();
+        } else {
+            path.erase(path.begin() + target + 1);
+        }
+        replacement->setRight(removed->getRight());
+        replacement->getRight()->setParent(replacement);
+        replacement->setParent(parent);
+        replacement->setHeight(removed->getHeight());
+        path[target] = replacement;
+    }
+    if (parent == NULL) {
+        this->mRoot = replacement;
+    } else if (parent->getLeft() == removed) {
+        parent->setLeft(replacement);
+    } else {
+        parent->setRight(replacement);
+    }
+
+    // Anyone else who wants the Node has to get its parent's Latch first, so nobody is waiting for it
+    this->destroyNode(removed);
+    retraceRemove(path, rootHeld);
+    releaseAll(path, rootHeld);
+}
+
+/**
+* Looks for the given key, and copies its value into value if it is found. Safe to call from several threads at
+* once, and never blocks other readers.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ConcurrentAVLTree<Key, Value, Compare, Allocator>::find(const Key& key, Value& value) const
+{
+    mRootLatch.lockShared();
+    auto node = static_cast<NodeType*>(this->mRoot);
+    if (node == NULL) {
+        mRootLatch.unlockShared();
+        return false;
+    }
+    node->getLatch().lockShared();
+    mRootLatch.unlockShared();
+
+    while (true) {
+        int order = this->compareKeys(key, node->getKey());
+        if (order == 0) {
+            value = node->getValue();
+            node->getLatch().unlockShared();
+            return true;
+        }
+        auto child = (order < 0) ? node->getLeft() : node->getRight();
+        if (child == NULL) {
+            node->getLatch().unlockShared();
+            return false;
+        }
+        child->getLatch().lockShared();
+        node->getLatch().unlockShared();
+        node = child;
+    }
+}
+
+/**
+* A helper function that lets go of every Latch above the last two Nodes of the path, including the root pointer's.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::releaseAbove(std::vector<NodeType*>& path, bool& rootHeld)
+{
+    if (rootHeld) {
+        mRootLatch.unlock();
+        rootHeld = false;
+    }
+    for (std::size_t i = 0; i + 1 < path.size(); i++) {
+        path[i]->getLatch().unlock();
+    }
+    path.erase(path.begin(), path.end() - 1);
+}
+
+/**
+* A helper function that lets go of every Latch a writer holds.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::releaseAll(std::vector<NodeType*>& path, bool& rootHeld)
+{
+    if (rootHeld) {
+        mRootLatch.unlock();
+        rootHeld = false;
+    }
+    for (auto node : path) {
+        node->getLatch().unlock();
+    }
+    path.clear();
+}
+
+/**
+* A helper function that walks back up the held path after an insert at its bottom, updating heights and doing
+* at most one single or double rotation. Both the child and grandchild that such a rotation moves are on the path.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::retraceInsert(std::vector<NodeType*>& path, bool rootHeld)
+{
+    for (std::size_t i = path.size(); i-- > 0; ) {
+        auto current = path[i];
+        int oldHeight = current->getHeight();
+        updateHeight(current);
+        if (abs(balanceOf(current)) > 1) {
+            rotateAt(current, i == 0 && rootHeld, false);
+            return;
+        }
+        if (current->getHeight() == oldHeight) {
+            return;
+        }
+    }
+}
+
+/**
+* A helper function that walks back up the held path after a remove below its bottom, updating heights and
+* rotating every unbalanced Node, until a subtree keeps its height. The taller side that a rotation moves is off
+* the path, so its Latches are taken for the rotation.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::retraceRemove(std::vector<NodeType*>& path, bool rootHeld)
+{
+    for (std::size_t i = path.size(); i-- > 0; ) {
+        auto current = path[i];
+        int oldHeight = current->getHeight();
+        updateHeight(current);
+        if (abs(balanceOf(current)) > 1) {
+            current = rotateAt(current, i == 0 && rootHeld, true);
+        }
+        if (current->getHeight() == oldHeight) {
+            return;
+        }
+    }
+}
+
+/**
+* Fixes a Node whose balance factor is off by two with a single or double rotation from rotateBST, and returns the
+* new root of the subtree. Only a rotation of the tree's root may change the tree's root pointer. If latchChildren
+* is set, the Latches of the Nodes that move up are taken for the rotation.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename ConcurrentAVLTree<Key, Value, Compare, Allocator>::NodeType* ConcurrentAVLTree<Key, Value, Compare, Allocator>::rotateAt(NodeType* root, bool isRoot, bool latchChildren)
+{
+    Node<Key, Value>* notRoot = NULL;
+    Node<Key, Value>*& rootPointer = isRoot ? this->mRoot : notRoot;
+    bool leftHeavy = balanceOf(root) < 0;
+    auto child = leftHeavy ? root->getLeft() : root->getRight();
+    if (latchChildren) {
+        child->getLatch().lock();
+    }
+
+    // If the child leans the other way, first turning the case into a single rotation
+    NodeType* grandchild = NULL;
+    if (leftHeavy ? balanceOf(child) > 0 : balanceOf(child) < 0) {
+        grandchild = leftHeavy ? child->getRight() : child->getLeft();
+        if (latchChildren) {
+            grandchild->getLatch().lock();
+        }
+        if (leftHeavy) {
+            this->leftRotate(child, notRoot);
+        } else {
+            this->rightRotate(child, notRoot);
+        }
+        updateHeight(child);
+        updateHeight(grandchild);
+    }
+    if (leftHeavy) {
+        this->rightRotate(root, rootPointer);
+    } else {
+        this->leftRotate(root, rootPointer);
+    }
+
+    auto newRoot = (grandchild != NULL) ? grandchild : child;
+    updateHeight(root);
+    updateHeight(newRoot);
+    if (latchChildren) {
+        child->getLatch().unlock();
+        if (grandchild != NULL) {
+            grandchild->getLatch().unlock();
+        }
+    }
+    return newRoot;
+}
+
+/**
+* Returns the stored height of a Node, where an empty subtree has a height of 0.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+int ConcurrentAVLTree<Key, Value, Compare, Allocator>::heightOf(NodeType* root)
+{
+    return (root == NULL) ? 0 : root->getHeight();
+}
+
+/**
+* Returns the balance factor of a Node, the height of the right subtree minus the height of the left subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+int ConcurrentAVLTree<Key, Value, Compare, Allocator>::balanceOf(NodeType* root)
+{
+    return heightOf(root->getRight()) - heightOf(root->getLeft());
+}
+
+/**
+* Recomputes the height of a Node from its children. A Node's height only changes while its parent's Latch is
+* held, so reading the children's heights is safe for the holder of the Node's Latch.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ConcurrentAVLTree<Key, Value, Compare, Allocator>::updateHeight(NodeType* root)
+{
+    root->setHeight(std::max(heightOf(root->getLeft()), heightOf(root->getRight())) + 1);
+}
+
+/*
+	---------------------------------------------------
+	End implementations for the ConcurrentAVLTree class.
+	---------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,596 @@
+//
+// An AVL tree whose changes are kept in an append-only log on disk, with periodic checkpoints to recover from.
+//
+
+#ifndef DURABLETREE_H
+#define DURABLETREE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "avlbst.h"
+#include "treesnapshot.h"
+
+/**
+* A file that is only ever appended to, for the records of an operation log.
+*/
+class LogFile
+{
+public:
+    LogFile();
+    ~LogFile();
+    LogFile(const LogFile& other) = delete;
+    LogFile& operator=(const LogFile& other) = delete;
+
+    void open(const std::string& path);
+    void close();
+    void append(const std::string& data);
+    void sync();
+    std::uint64_t size() const;
+
+private:
+    std::string mPath;
+    int mFile;
+    std::uint64_t mSize;
+};
+
+/**
+* An AVLTree that survives crashes. Every insert() and remove() is written to an append-only log as a record with a
+* checksum, and only returns once its record is on disk. Writers that arrive while the log is being synced queue
+* their records up, and the first of them writes and syncs the whole group at once (group commit), so a busy tree
+* pays for one fsync per group rather than one per change.
+*
+* Once the log has grown past checkpointBytes, or when checkpoint() is called, the tree is copied and the log is set
+* aside for a fresh one. Writers only wait for the copy, which is then saved as a snapshot (see treesnapshot.h) and
+* the logs it covers are deleted. Opening the directory again loads the latest checkpoint and replays whatever logs
+* are left, which is safe even for records the checkpoint already has, since replaying a change gives the same
+* result twice. A record cut short by a crash ends the log and is cut off.
+*
+* find() may see a change whose insert() or remove() has not returned yet, and so is not on disk yet.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator,
+          typename KeyCodec = SnapshotCodec<Key>, typename ValueCodec = SnapshotCodec<Value> >
+class DurableTree
+{
+public:
+    typedef AVLTree<Key, Value, Compare, Allocator> TreeType;
+
+    explicit DurableTree(const std::string& directory, std::uint64_t checkpointBytes = 64 << 20,
+                         const Compare& compare = Compare());
+    DurableTree(const DurableTree& other) = delete;
+    DurableTree& operator=(const DurableTree& other) = delete;
+
+    void insert(const std::pair<Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value) const;
+    void checkpoint();
+    std::exception_ptr checkpointFailure() const;
+
+private:
+    void checkpointIfFull();
+    void writeCheckpoint();
+    void recover();
+    void replay(const std::string& path, bool last);
+    std::vector<unsigned> rotatedLogs() const;
+    void log(std::string& record);
+    void waitDurable(std::unique_lock<std::mutex>& lock, std::uint64_t count);
+    void checkFailure() const;
+    void syncDirectory() const;
+    std::string path(const std::string& name) const;
+    static std::uint32_t checksum(const char* data, std::size_t size);
+
+    // Every record starts with the length of the rest of it, a checksum of the rest, and the operation
+    static const std::size_t RECORD_HEADER = 9;
+    static const char INSERT = 1;
+    static const char REMOVE = 2;
+
+    std::string mDirectory;
+    std::uint64_t mCheckpointBytes;
+    TreeType mTree;
+    LogFile mLog;
+
+    // Guards the tree, the log and the records waiting to be written
+    mutable std::mutex mLock;
+    std::condition_variable mFlushed;
+    std::string mPending;
+    std::uint64_t mLoggedCount;
+    std::uint64_t mDurableCount;
+    std::uint64_t mLogBytes;
+    bool mFlushing;
+    std::exception_ptr mFailure;
+
+    // Why the last checkpoint that insert() or remove() started failed, or NULL if it did not
+    std::exception_ptr mCheckpointFailure;
+
+    // Only one checkpoint runs at a time, and it names the next log it sets aside
+    std::mutex mCheckpointLock;
+    unsigned mNextGeneration;
+};
+
+/*
+	-------------------------------------------
+	Begin implementations for the LogFile class.
+	-------------------------------------------
+*/
+
+/**
+* Constructor for a LogFile that is not open yet.
+*/
+inline LogFile::LogFile()
+        : mFile(-1), mSize(0)
+{
+
+}
+
+/**
+* Deconstructor, which closes the file.
+*/
+inline LogFile::~LogFile()
+{
+    close();
+}
+
+/**
+* Opens a log for appending, creating it if it does not exist yet.
+*/
+inline void LogFile::open(const std::string& path)
+{
+    close();
+    mPath = path;
+    mFile = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (mFile < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+    }
+    struct stat status;
+    if (::fstat(mFile, &status) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot read " + path);
+    }
+    mSize = status.st_size;
+}
+
+/**
+* Closes the log, if it is open.
+*/
+inline void LogFile::close()
+{
+    if (mFile >= 0) {
+        ::close(mFile);
+        mFile = -1;
+    }
+}
+
+/**
+* Writes data to the end of the log, however many calls that takes. It is not durable until sync().
+*/
+inline void LogFile::append(const std::string& data)
+{
+    const char* next = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+        ssize_t written = ::write(mFile, next, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Cannot write " + mPath);
+        }
+        next += written;
+        left -= written;
+        mSize += written;
+    }
+}
+
+/**
+* Waits until everything appended so far is on disk.
+*/
+inline void LogFile::sync()
+{
+    if (::fdatasync(mFile) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot sync " + mPath);
+    }
+}
+
+/**
+* Returns the size of the log in bytes.
+*/
+inline std::uint64_t LogFile::size() const
+{
+    return mSize;
+}
+
+/*
+	-----------------------------------------
+	End implementations for the LogFile class.
+	-----------------------------------------
+*/
+
+/*
+	-----------------------------------------------
+	Begin implementations for the DurableTree class.
+	-----------------------------------------------
+*/
+
+/**
+* Constructor that opens the tree kept in a directory, creating the directory if need be, and recovers its
+* contents from the checkpoint and logs there.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::DurableTree(const std::string& directory,
+                                                                               std::uint64_t checkpointBytes,
+                                                                               const Compare& compare)
+        : mDirectory(directory), mCheckpointBytes(checkpointBytes), mTree(compare), mLoggedCount(0), mDurableCount(0),
+          mLogBytes(0), mFlushing(false), mNextGeneration(0)
+{
+    if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create " + directory);
+    }
+    recover();
+    mLog.open(path("log"));
+    mLogBytes = mLog.size();
+}
+
+/**
+* Inserts a key-value pair, overwriting the value if the key is already in the tree, and returns once the change
+* is on disk. Checkpoints the tree if the log has grown large enough.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    std::string record(RECORD_HEADER, '\0');
+    record[8] = INSERT;
+    KeyCodec::encode(keyValuePair.first, record);
+    ValueCodec::encode(keyValuePair.second, record);
+    log(record);
+
+    std::unique_lock<std::mutex> lock(mLock);
+    checkFailure();
+    mTree.insert(keyValuePair);
+    mPending += record;
+    waitDurable(lock, ++mLoggedCount);
+    lock.unlock();
+    checkpointIfFull();
+}
+
+/**
+* Removes the item with the given key, if there is one, and returns once the change is on disk. A key that is not
+* in the tree writes nothing.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::remove(const Key& key)
+{
+    std::string record(RECORD_HEADER, '\0');
+    record[8] = REMOVE;
+    KeyCodec::encode(key, record);
+    log(record);
+
+    std::unique_lock<std::mutex> lock(mLock);
+    checkFailure();
+    if (mTree.find(key) == mTree.end()) {
+        return;
+    }
+    mTree.remove(key);
+    mPending += record;
+    waitDurable(lock, ++mLoggedCount);
+    lock.unlock();
+    checkpointIfFull();
+}
+
+/**
+* Looks for the given key, and copies its value into value if it is found.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+bool DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::find(const Key& key, Value& value) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto found = mTree.find(key);
+    if (found == mTree.end()) {
+        return false;
+    }
+    value = found->second;
+    return true;
+}
+
+/**
+* Writes a checkpoint of the tree and deletes the logs it makes unnecessary, waiting for any checkpoint that is
+* already being written to finish first. Unlike the checkpoints insert() and remove() start, a failure is thrown.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::checkpoint()
+{
+    std::lock_guard<std::mutex> checkpointing(mCheckpointLock);
+    writeCheckpoint();
+    std::lock_guard<std::mutex> lock(mLock);
+    mCheckpointFailure = NULL;
+}
+
+/**
+* Returns why the last checkpoint started by insert() or remove() failed, or NULL if it succeeded. Those calls
+* have already made their change durable by the time they checkpoint, so they keep the error here instead of
+* throwing it; the logs stay until a later checkpoint succeeds.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+std::exception_ptr DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::checkpointFailure() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mCheckpointFailure;
+}
+
+/**
+* A helper function for insert() and remove() that checkpoints the tree once the log has grown past
+* checkpointBytes, unless another thread is already doing so. A failure is kept for checkpointFailure() rather
+* than thrown, since the change that triggered the checkpoint is already on disk.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::checkpointIfFull()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mLogBytes < mCheckpointBytes) {
+            return;
+        }
+    }
+    std::unique_lock<std::mutex> checkpointing(mCheckpointLock, std::try_to_lock);
+    if (!checkpointing.owns_lock()) {
+        return;
+    }
+    std::exception_ptr failure;
+    try {
+        writeCheckpoint();
+    } catch (...) {
+        failure = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    mCheckpointFailure = failure;
+}
+
+/**
+* A helper function that writes a checkpoint while holding mCheckpointLock. The tree is copied and the log is
+* renamed out of the way while writers wait, and the copy is saved while they carry on into a fresh log. If saving
+* fails, the set aside logs stay and the next checkpoint covers them as well.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::writeCheckpoint()
+{
+    TreeType copy;
+    unsigned generation;
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        checkFailure();
+        // Records still waiting go to the fresh log, where replaying them over the checkpoint changes nothing
+        while (mFlushing) {
+            mFlushed.wait(lock);
+        }
+        copy = mTree;
+        generation = mNextGeneration++;
+        mLog.close();
+        std::string rotated = path("log." + std::to_string(generation));
+        if (::rename(path("log").c_str(), rotated.c_str()) != 0) {
+            int error = errno;
+            mLog.open(path("log"));
+            throw std::system_error(error, std::generic_category(), "Cannot rotate the log in " + mDirectory);
+        }
+        mLog.open(path("log"));
+        mLogBytes = 0;
+        syncDirectory();
+    }
+
+    copy.template save<KeyCodec, ValueCodec>(path("checkpoint"));
+    syncDirectory();
+    for (unsigned older : rotatedLogs()) {
+        if (older <= generation) {
+            ::unlink(path("log." + std::to_string(older)).c_str());
+        }
+    }
+}
+
+/**
+* A helper function for the constructor that loads the checkpoint, if there is one, and replays the logs set aside
+* by checkpoints that did not finish, oldest first, followed by the current log.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::recover()
+{
+    if (::access(path("checkpoint").c_str(), F_OK) == 0) {
+        mTree.template load<KeyCodec, ValueCodec>(path("checkpoint"));
+    }
+    for (unsigned generation : rotatedLogs()) {
+        replay(path("log." + std::to_string(generation)), false);
+        mNextGeneration = generation + 1;
+    }
+    if (::access(path("log").c_str(), F_OK) == 0) {
+        replay(path("log"), true);
+    }
+}
+
+/**
+* A helper function that applies the records of a log to the tree. A record that is cut short or fails its
+* checksum ends the log, and is cut off if this is the current log, which a crash may have left half written.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::replay(const std::string& path, bool last)
+{
+    SnapshotFile file(path);
+    const char* next = file.data();
+    const char* end = next + file.size();
+    while (static_cast<std::size_t>(end - next) >= RECORD_HEADER) {
+        std::uint32_t length;
+        std::uint32_t sum;
+        std::memcpy(&length, next, sizeof(length));
+        std::memcpy(&sum, next + 4, sizeof(sum));
+        if (length < 1 || static_cast<std::size_t>(end - next - 8) < length ||
+                checksum(next + 8, length) != sum) {
+            break;
+        }
+        const char* body = next + RECORD_HEADER;
+        const char* bodyEnd = next + 8 + length;
+        Key key = KeyCodec::decode(body, bodyEnd);
+        if (next[8] == INSERT) {
+            Value value = ValueCodec::decode(body, bodyEnd);
+            mTree.insert(std::make_pair(key, value));
+        } else {
+            mTree.remove(key);
+        }
+        next = bodyEnd;
+    }
+    if (last && next != end && ::truncate(path.c_str(), next - file.data()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot repair " + path);
+    }
+}
+
+/**
+* A helper function that returns the generations of the logs set aside by checkpoints, oldest first.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+std::vector<unsigned> DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::rotatedLogs() const
+{
+    std::vector<unsigned> generations;
+    DIR* directory = ::opendir(mDirectory.c_str());
+    if (directory == NULL) {
+        throw std::system_error(errno, std::generic_category(), "Cannot list " + mDirectory);
+    }
+    while (struct dirent* entry = ::readdir(directory)) {
+        const char* name = entry->d_name;
+        if (std::strncmp(name, "log.", 4) == 0 && name[4] != '\0' &&
+                std::strspn(name + 4, "0123456789") == std::strlen(name + 4)) {
+            generations.push_back(std::stoul(name + 4));
+        }
+    }
+    ::closedir(directory);
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+/**
+* A helper function that fills in the length and checksum at the start of an encoded record.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::log(std::string& record)
+{
+    std::uint32_t length = record.size() - 8;
+    std::uint32_t sum = checksum(record.data() + 8, length);
+    std::memcpy(&record[0], &length, sizeof(length));
+    std::memcpy(&record[4], &sum, sizeof(sum));
+}
+
+/**
+* A helper function that waits until the first count records are on disk. If nobody is writing the log, the
+* caller writes and syncs every record waiting so far, letting go of the lock meanwhile so that more records can
+* queue up behind them. A failed write leaves the tree unable to take changes, since its log has a hole in it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::waitDurable(std::unique_lock<std::mutex>& lock,
+                                                                                    std::uint64_t count)
+{
+    while (mDurableCount < count) {
+        checkFailure();
+        if (mFlushing) {
+            mFlushed.wait(lock);
+            continue;
+        }
+
+        mFlushing = true;
+        std::string batch;
+        batch.swap(mPending);
+        std::uint64_t batchCount = mLoggedCount;
+        lock.unlock();
+        try {
+            mLog.append(batch);
+            mLog.sync();
+        } catch (...) {
+            lock.lock();
+            mFailure = std::current_exception();
+            mFlushing = false;
+            mFlushed.notify_all();
+            throw;
+        }
+        lock.lock();
+        mDurableCount = batchCount;
+        mLogBytes += batch.size();
+        mFlushing = false;
+        mFlushed.notify_all();
+    }
+}
+
+/**
+* A helper function that passes on the error that stopped the log, if one did.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::checkFailure() const
+{
+    if (mFailure) {
+        std::rethrow_exception(mFailure);
+    }
+}
+
+/**
+* A helper function that makes the files created, renamed and deleted in the directory durable.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+void DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::syncDirectory() const
+{
+    int directory = ::open(mDirectory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + mDirectory);
+    }
+    int result = ::fsync(directory);
+    int error = errno;
+    ::close(directory);
+    if (result != 0) {
+        throw std::system_error(error, std::generic_category(), "Cannot sync " + mDirectory);
+    }
+}
+
+/**
+* A helper function that returns the path of a file in the tree's directory.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+std::string DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::path(const std::string& name) const
+{
+    return mDirectory + "/" + name;
+}
+
+/**
+* A helper function that computes the CRC-32 of a record, to tell a record cut short by a crash from a whole one.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename KeyCodec, typename ValueCodec>
+std::uint32_t DurableTree<Key, Value, Compare, Allocator, KeyCodec, ValueCodec>::checksum(const char* data, std::size_t size)
+{
+    static const std::vector<std::uint32_t> table = []() {
+        std::vector<std::uint32_t> entries(256);
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t entry = i;
+            for (int bit = 0; bit < 8; bit++) {
+                entry = (entry & 1) ? (entry >> 1) ^ 0xEDB88320u : entry >> 1;
+            }
+            entries[i] = entry;
+        }
+        return entries;
+    }();
+
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*
+	---------------------------------------------
+	End implementations for the DurableTree class.
+	---------------------------------------------
+*/
+
+#endif
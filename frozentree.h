@@ -0,0 +1,632 @@
+//
+// A read-only search index that a tree from bst.h, rotateBST.h or avlbst.h can be frozen into.
+//
+
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <utility>
+
+/**
+* An immutable sorted map laid out in Eytzinger (breadth first) order: the root key is at index 1, and the
+* children of the key at index k are at 2k and 2k + 1. The keys are one contiguous, cache line aligned array and
+* the values are a parallel array, so a lookup only touches keys, reads the first few levels out of the same cache
+* lines every time, and can prefetch the lines four levels ahead. The descent has no data dependent branches.
+*
+* A FrozenTree is built from a sorted range of pairs in O(n) without comparing any keys, usually with the tree's
+* freeze(). Building into an existing FrozenTree of at least the same size reuses its arrays, so freezing again
+* after a batch of writes costs one pass over the tree and no allocations.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class FrozenTree
+{
+public:
+    FrozenTree();
+    explicit FrozenTree(const Compare& compare);
+    template <typename ForwardIterator>
+    FrozenTree(ForwardIterator first, ForwardIterator last, const Compare& compare = Compare());
+    FrozenTree(const FrozenTree& other);
+    FrozenTree(FrozenTree&& other);
+    ~FrozenTree();
+
+    FrozenTree& operator=(const FrozenTree& other);
+    FrozenTree& operator=(FrozenTree&& other);
+
+    // Replaces the contents with a range of pairs whose keys are strictly increasing
+    template <typename ForwardIterator>
+    void assign(ForwardIterator first, ForwardIterator last);
+    template <typename ForwardIterator>
+    void assign(ForwardIterator first, ForwardIterator last, const Compare& compare);
+    void clear();
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /**
+    * An iterator that visits the items in sorted order. The items are not stored as pairs, so dereferencing it
+    * gives a pair of references to the key and the value.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<const Key&, const Value&> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef std::pair<const Key&, const Value&> reference;
+
+        iterator();
+
+        const Key& key() const;
+        const Value& value() const;
+        std::pair<const Key&, const Value&> operator*() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        iterator(const FrozenTree* tree, std::size_t index);
+
+        const FrozenTree* mTree;
+        std::size_t mIndex;
+
+        friend class FrozenTree<Key, Value, Compare>;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+
+private:
+    std::size_t lowerBoundIndex(const Key& key) const;
+    std::size_t upperBoundIndex(const Key& key) const;
+    void prefetchDescendants(std::size_t index) const;
+    static std::size_t leftmost(std::size_t index, std::size_t size);
+    static std::size_t successor(std::size_t index, std::size_t size);
+    static std::size_t resolve(std::size_t index);
+    void reserve(std::size_t size);
+    void destroyItems();
+    void release();
+
+    static const std::size_t CACHE_LINE = 64;
+    // How many keys sit on one cache line, which is also how many descendants four (or fewer) levels down share one
+    static const std::size_t PREFETCH_STRIDE = (sizeof(Key) >= CACHE_LINE) ? 1 : CACHE_LINE / sizeof(Key);
+
+    // Both arrays have size + 1 slots, and slot 0 is never used, so that index 0 can stand for "not found"
+    void* mMemory;
+    Key* mKeys;
+    Value* mValues;
+    std::size_t mSize;
+    std::size_t mCapacity;
+    Compare mCompare;
+};
+
+/*
+	------------------------------------------------------
+	Begin implementations for the FrozenTree::iterator class.
+	------------------------------------------------------
+*/
+
+/**
+* A default constructor for an iterator that points nowhere.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::iterator::iterator()
+        : mTree(NULL)
+        , mIndex(0)
+{
+
+}
+
+/**
+* Constructor for an iterator at an Eytzinger index, where index 0 is the end.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::iterator::iterator(const FrozenTree* tree, std::size_t index)
+        : mTree(tree)
+        , mIndex(index)
+{
+
+}
+
+/**
+* A getter for the key of the item.
+*/
+template<typename Key, typename Value, typename Compare>
+const Key& FrozenTree<Key, Value, Compare>::iterator::key() const
+{
+    return mTree->mKeys[mIndex];
+}
+
+/**
+* A getter for the value of the item.
+*/
+template<typename Key, typename Value, typename Compare>
+const Value& FrozenTree<Key, Value, Compare>::iterator::value() const
+{
+    return mTree->mValues[mIndex];
+}
+
+/**
+* Dereferences the iterator into a pair of references to the key and the value.
+*/
+template<typename Key, typename Value, typename Compare>
+std::pair<const Key&, const Value&> FrozenTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return std::pair<const Key&, const Value&>(mTree->mKeys[mIndex], mTree->mValues[mIndex]);
+}
+
+/**
+* Checks if two iterators point at the same item.
+*/
+template<typename Key, typename Value, typename Compare>
+bool FrozenTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return mIndex == rhs.mIndex;
+}
+
+/**
+* Checks if two iterators point at different items.
+*/
+template<typename Key, typename Value, typename Compare>
+bool FrozenTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return mIndex != rhs.mIndex;
+}
+
+/**
+* Advances the iterator to the next larger key, by an in-order step through the implicit tree.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator& FrozenTree<Key, Value, Compare>::iterator::operator++()
+{
+    mIndex = successor(mIndex, mTree->mSize);
+    return *this;
+}
+
+/*
+	----------------------------------------------------
+	End implementations for the FrozenTree::iterator class.
+	----------------------------------------------------
+*/
+
+/*
+	---------------------------------------------
+	Begin implementations for the FrozenTree class.
+	---------------------------------------------
+*/
+
+/**
+* Default constructor for an empty FrozenTree, which takes no memory.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::FrozenTree()
+        : mMemory(NULL)
+        , mKeys(NULL)
+        , mValues(NULL)
+        , mSize(0)
+        , mCapacity(0)
+        , mCompare()
+{
+
+}
+
+/**
+* Constructor for an empty FrozenTree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::FrozenTree(const Compare& compare)
+        : mMemory(NULL)
+        , mKeys(NULL)
+        , mValues(NULL)
+        , mSize(0)
+        , mCapacity(0)
+        , mCompare(compare)
+{
+
+}
+
+/**
+* Constructor that builds the FrozenTree from a range of pairs. See assign().
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename ForwardIterator>
+FrozenTree<Key, Value, Compare>::FrozenTree(ForwardIterator first, ForwardIterator last, const Compare& compare)
+        : mMemory(NULL)
+        , mKeys(NULL)
+        , mValues(NULL)
+        , mSize(0)
+        , mCapacity(0)
+        , mCompare(compare)
+{
+    assign(first, last);
+}
+
+/**
+* Copy constructor. The layout is copied as it is, without rebuilding anything.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::FrozenTree(const FrozenTree& other)
+        : mMemory(NULL)
+        , mKeys(NULL)
+        , mValues(NULL)
+        , mSize(0)
+        , mCapacity(0)
+        , mCompare(other.mCompare)
+{
+    *this = other;
+}
+
+/**
+* Move constructor, which takes over the arrays of other and leaves it empty.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::FrozenTree(FrozenTree&& other)
+        : mMemory(other.mMemory)
+        , mKeys(other.mKeys)
+        , mValues(other.mValues)
+        , mSize(other.mSize)
+        , mCapacity(other.mCapacity)
+        , mCompare(other.mCompare)
+{
+    other.mMemory = NULL;
+    other.mKeys = NULL;
+    other.mValues = NULL;
+    other.mSize = 0;
+    other.mCapacity = 0;
+}
+
+/**
+* Destructor, which destroys the items and frees both arrays.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>::~FrozenTree()
+{
+    release();
+}
+
+/**
+* Copy assignment, which reuses this FrozenTree's arrays if they are large enough.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>& FrozenTree<Key, Value, Compare>::operator=(const FrozenTree& other)
+{
+    if (&other == this) {
+        return *this;
+    }
+    destroyItems();
+    reserve(other.mSize);
+    mCompare = other.mCompare;
+    for (std::size_t i = 1; i <= other.mSize; i++) {
+        new (mKeys + i) Key(other.mKeys[i]);
+        try {
+            new (mValues + i) Value(other.mValues[i]);
+        } catch (...) {
+            mKeys[i].~Key();
+            throw;
+        }
+        mSize = i;
+    }
+    return *this;
+}
+
+/**
+* Move assignment, which frees this FrozenTree's arrays and takes over the ones of other.
+*/
+template<typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare>& FrozenTree<Key, Value, Compare>::operator=(FrozenTree&& other)
+{
+    if (&other == this) {
+        return *this;
+    }
+    release();
+    mMemory = other.mMemory;
+    mKeys = other.mKeys;
+    mValues = other.mValues;
+    mSize = other.mSize;
+    mCapacity = other.mCapacity;
+    mCompare = other.mCompare;
+    other.mMemory = NULL;
+    other.mKeys = NULL;
+    other.mValues = NULL;
+    other.mSize = 0;
+    other.mCapacity = 0;
+    return *this;
+}
+
+/**
+* Replaces the contents with the pairs in [first, last), which have to be sorted by strictly increasing keys, as a
+* tree's iterators give them. The range is read twice, once to count it and once to fill the arrays in Eytzinger
+* order by walking the implicit tree in order. The arrays are only reallocated if they are too small.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename ForwardIterator>
+void FrozenTree<Key, Value, Compare>::assign(ForwardIterator first, ForwardIterator last)
+{
+    std::size_t size = static_cast<std::size_t>(std::distance(first, last));
+    destroyItems();
+    reserve(size);
+
+    // The sorted items go to the implicit tree's Nodes in order, so the i-th smallest key lands where it belongs
+    std::size_t built = 0;
+    std::size_t index = leftmost(1, size);
+    try {
+        for (ForwardIterator it = first; it != last; ++it) {
+            new (mKeys + index) Key(it->first);
+            try {
+                new (mValues + index) Value(it->second);
+            } catch (...) {
+                mKeys[index].~Key();
+                throw;
+            }
+            built++;
+            index = successor(index, size);
+        }
+    } catch (...) {
+        // The built items are scattered over the layout for size items, so they are found by the same walk
+        index = leftmost(1, size);
+        for (std::size_t i = 0; i < built; i++) {
+            mKeys[index].~Key();
+            mValues[index].~Value();
+            index = successor(index, size);
+        }
+        throw;
+    }
+    mSize = size;
+}
+
+/**
+* Replaces the contents like assign(), and from now on orders keys with the given Compare, which the range has to
+* be sorted by.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename ForwardIterator>
+void FrozenTree<Key, Value, Compare>::assign(ForwardIterator first, ForwardIterator last, const Compare& compare)
+{
+    mCompare = compare;
+    assign(first, last);
+}
+
+/**
+* Removes every item but keeps the arrays for the next assign().
+*/
+template<typename Key, typename Value, typename Compare>
+void FrozenTree<Key, Value, Compare>::clear()
+{
+    destroyItems();
+}
+
+/**
+* Returns the number of items.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::size() const
+{
+    return mSize;
+}
+
+/**
+* Returns true if there are no items.
+*/
+template<typename Key, typename Value, typename Compare>
+bool FrozenTree<Key, Value, Compare>::empty() const
+{
+    return mSize == 0;
+}
+
+/**
+* Returns an iterator to the item with the smallest key.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator FrozenTree<Key, Value, Compare>::begin() const
+{
+    return iterator(this, leftmost(1, mSize));
+}
+
+/**
+* Returns the iterator past the largest key.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator FrozenTree<Key, Value, Compare>::end() const
+{
+    return iterator(this, 0);
+}
+
+/**
+* Returns an iterator to the item with the given key, or the end iterator if there is none. This is a
+* lower_bound() plus one more comparison.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator FrozenTree<Key, Value, Compare>::find(const Key& key) const
+{
+    std::size_t index = lowerBoundIndex(key);
+    if (index != 0 && mCompare(key, mKeys[index])) {
+        index = 0;
+    }
+    return iterator(this, index);
+}
+
+/**
+* Returns an iterator to the first item whose key is not smaller than the given key, or the end iterator.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator FrozenTree<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(this, lowerBoundIndex(key));
+}
+
+/**
+* Returns an iterator to the first item whose key is larger than the given key, or the end iterator.
+*/
+template<typename Key, typename Value, typename Compare>
+typename FrozenTree<Key, Value, Compare>::iterator FrozenTree<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return iterator(this, upperBoundIndex(key));
+}
+
+/**
+* A helper function that descends the implicit tree all the way down, going right whenever the key at the
+* current index is smaller. The comparison becomes the low bit of the next index instead of a branch, so every
+* lookup takes the same number of steps. The last left turn is the answer, and it is found by dropping the right
+* turns taken after it from the final index.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::lowerBoundIndex(const Key& key) const
+{
+    std::size_t index = 1;
+    while (index <= mSize) {
+        prefetchDescendants(index);
+        index = 2 * index + static_cast<std::size_t>(mCompare(mKeys[index], key));
+    }
+    return resolve(index);
+}
+
+/**
+* The same descent as lowerBoundIndex(), going right whenever the key at the current index is not larger.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::upperBoundIndex(const Key& key) const
+{
+    std::size_t index = 1;
+    while (index <= mSize) {
+        prefetchDescendants(index);
+        index = 2 * index + static_cast<std::size_t>(!mCompare(key, mKeys[index]));
+    }
+    return resolve(index);
+}
+
+/**
+* Asks for the cache line holding the descendants of an index a few levels down, which the descent will need by
+* the time it gets there.
+*/
+template<typename Key, typename Value, typename Compare>
+void FrozenTree<Key, Value, Compare>::prefetchDescendants(std::size_t index) const
+{
+#if defined(__GNUC__)
+    std::size_t ahead = index * PREFETCH_STRIDE;
+    if (ahead <= mSize) {
+        __builtin_prefetch(mKeys + ahead);
+    }
+#else
+    (void)index;
+#endif
+}
+
+/**
+* Turns the index a descent fell off the tree at into the index of the answer, by shifting out the trailing right
+* turns and then the left turn before them. Gives 0 if the descent only ever turned right.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::resolve(std::size_t index)
+{
+#if defined(__GNUC__)
+    return index >> __builtin_ffsll(static_cast<long long>(~index));
+#else
+    while (index & 1) {
+        index >>= 1;
+    }
+    return index >> 1;
+#endif
+}
+
+/**
+* Returns the smallest index in the implicit subtree at index, or 0 if the subtree is empty.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::leftmost(std::size_t index, std::size_t size)
+{
+    if (index > size) {
+        return 0;
+    }
+    while (2 * index <= size) {
+        index = 2 * index;
+    }
+    return index;
+}
+
+/**
+* Returns the index that follows an index in order, or 0 after the largest one. Like a parent pointer walk in a
+* real tree, but on index arithmetic.
+*/
+template<typename Key, typename Value, typename Compare>
+std::size_t FrozenTree<Key, Value, Compare>::successor(std::size_t index, std::size_t size)
+{
+    // The smallest index of the right subtree, if there is one
+    if (2 * index + 1 <= size) {
+        return leftmost(2 * index + 1, size);
+    }
+    // Otherwise the first ancestor that this index is in the left subtree of
+    while (index & 1) {
+        index >>= 1;
+    }
+    return index >> 1;
+}
+
+/**
+* Makes sure both arrays have room for size items, allocating new ones if they are too small. The key array
+* starts on a cache line, so the siblings at 2k and 2k + 1 never straddle two lines for small keys. The items must
+* already be destroyed.
+*/
+template<typename Key, typename Value, typename Compare>
+void FrozenTree<Key, Value, Compare>::reserve(std::size_t size)
+{
+    if (size <= mCapacity && mMemory != NULL) {
+        return;
+    }
+    release();
+
+    // One block for both arrays: padding to align the keys, the keys, then the values at their own alignment
+    std::size_t keyBytes = (size + 1) * sizeof(Key);
+    std::size_t valueOffset = (keyBytes + alignof(Value) - 1) / alignof(Value) * alignof(Value);
+    std::size_t bytes = CACHE_LINE + valueOffset + (size + 1) * sizeof(Value);
+    mMemory = ::operator new(bytes);
+
+    std::size_t address = reinterpret_cast<std::size_t>(mMemory);
+    std::size_t aligned = (address + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    mKeys = reinterpret_cast<Key*>(aligned);
+    mValues = reinterpret_cast<Value*>(aligned + valueOffset);
+    mCapacity = size;
+}
+
+/**
+* Destroys every item, keeping the arrays.
+*/
+template<typename Key, typename Value, typename Compare>
+void FrozenTree<Key, Value, Compare>::destroyItems()
+{
+    for (std::size_t i = 1; i <= mSize; i++) {
+        mKeys[i].~Key();
+        mValues[i].~Value();
+    }
+    mSize = 0;
+}
+
+/**
+* Destroys every item and frees the arrays.
+*/
+template<typename Key, typename Value, typename Compare>
+void FrozenTree<Key, Value, Compare>::release()
+{
+    destroyItems();
+    ::operator delete(mMemory);
+    mMemory = NULL;
+    mKeys = NULL;
+    mValues = NULL;
+    mCapacity = 0;
+}
+
+/*
+	-------------------------------------------
+	End implementations for the FrozenTree class.
+	-------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,313 @@
+//
+// Node allocators for the search trees in bst.h, rotateBST.h and avlbst.h.
+//
+
+#ifndef NODEALLOC_H
+#define NODEALLOC_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+/**
+* The default node allocator, which hands every node to the global operator new/delete just like a plain
+* new Node / delete would. It cannot release a tree's nodes in bulk, and since every NodeAllocator uses the same
+* heap, nodes can move freely between trees.
+*/
+template <typename T>
+class NodeAllocator
+{
+public:
+    // The global heap may be used from any thread, so nodes can be freed in the background
+    static const bool THREAD_SAFE = true;
+
+    T* allocate();
+    void deallocate(T* node);
+    bool releaseAll();
+    bool absorb(NodeAllocator& other);
+};
+
+/**
+* A slab/arena allocator for tree nodes. Nodes are carved out of contiguous chunks, freed nodes are recycled
+* through an intrusive free list, and releaseAll() frees every chunk at once in O(chunks). Chunks start small and
+* double in size up to a fixed cap.
+*
+* A PoolAllocator is a handle to its arena: copies share the arena, which is what lets a tree that was split off
+* another one free the nodes it was handed. The arena is freed with its last handle. It is not thread safe.
+*/
+template <typename T>
+class PoolAllocator
+{
+public:
+    PoolAllocator();
+
+    static const bool THREAD_SAFE = false;
+
+    T* allocate();
+    void deallocate(T* node);
+    bool releaseAll();
+    bool absorb(PoolAllocator& other);
+
+private:
+    // A slot either holds a live node or, while it is free, the link to the next free slot. The first slot of
+    // every chunk is used as the link to the previously allocated chunk.
+    union Slot
+    {
+        Slot* mNext;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type mStorage;
+    };
+
+    struct Arena
+    {
+        Arena();
+        ~Arena();
+        void addChunk();
+        void freeChunks();
+
+        Slot* mChunks;
+        Slot* mFreeList;
+        Slot* mFreeTail;
+        Slot* mNextSlot;
+        Slot* mEndSlot;
+        std::size_t mChunkSlots;
+    };
+
+    static const std::size_t FIRST_CHUNK_SLOTS = 64;
+    static const std::size_t MAX_CHUNK_SLOTS = 4096;
+
+    std::shared_ptr<Arena> mArena;
+};
+
+/*
+	--------------------------------------------------
+	Begin implementations for the NodeAllocator class.
+	--------------------------------------------------
+*/
+
+/**
+* Gets uninitialized memory for a single node.
+*/
+template<typename T>
+T* NodeAllocator<T>::allocate()
+{
+    return static_cast<T*>(::operator new(sizeof(T)));
+}
+
+/**
+* Gives back the memory of a node that has already been destroyed.
+*/
+template<typename T>
+void NodeAllocator<T>::deallocate(T* node)
+{
+    ::operator delete(node);
+}
+
+/**
+* Nodes from the global heap can only be freed one at a time, so this always returns false.
+*/
+template<typename T>
+bool NodeAllocator<T>::releaseAll()
+{
+    return false;
+}
+
+/**
+* Any NodeAllocator can free the nodes of any other, so there is nothing to take over.
+*/
+template<typename T>
+bool NodeAllocator<T>::absorb(NodeAllocator<T>& /* other */)
+{
+    return true;
+}
+
+/*
+	------------------------------------------------
+	End implementations for the NodeAllocator class.
+	------------------------------------------------
+*/
+
+/*
+	--------------------------------------------------
+	Begin implementations for the PoolAllocator class.
+	--------------------------------------------------
+*/
+
+/**
+* Default constructor. No memory is taken until the first node is allocated.
+*/
+template<typename T>
+PoolAllocator<T>::PoolAllocator()
+{
+
+}
+
+/**
+* Hands out a node, first from the free list, then from the unused end of the newest chunk.
+*/
+template<typename T>
+T* PoolAllocator<T>::allocate()
+{
+    if (mArena == NULL) {
+        mArena = std::make_shared<Arena>();
+    }
+    Arena& arena = *mArena;
+
+    Slot* slot;
+    if (arena.mFreeList != NULL) {
+        slot = arena.mFreeList;
+        arena.mFreeList = slot->mNext;
+        if (arena.mFreeList == NULL) {
+            arena.mFreeTail = NULL;
+        }
+    } else {
+        if (arena.mNextSlot == arena.mEndSlot) {
+            arena.addChunk();
+        }
+        slot = arena.mNextSlot++;
+    }
+    return reinterpret_cast<T*>(slot);
+}
+
+/**
+* Puts a destroyed node onto the free list so the next allocate() can reuse it.
+*/
+template<typename T>
+void PoolAllocator<T>::deallocate(T* node)
+{
+    Arena& arena = *mArena;
+    Slot* slot = reinterpret_cast<Slot*>(node);
+    slot->mNext = arena.mFreeList;
+    if (arena.mFreeList == NULL) {
+        arena.mFreeTail = slot;
+    }
+    arena.mFreeList = slot;
+}
+
+/**
+* Frees every chunk at once, as long as no other handle shares the arena. Any node still handed out becomes
+* invalid, so the caller must already have destroyed the nodes (or be sure their destructors do nothing).
+* Returns false if the arena is shared and nothing was freed.
+*/
+template<typename T>
+bool PoolAllocator<T>::releaseAll()
+{
+    if (mArena == NULL) {
+        return true;
+    }
+    if (mArena.use_count() != 1) {
+        return false;
+    }
+    mArena->freeChunks();
+    return true;
+}
+
+/**
+* Makes this allocator able to free the nodes handed out by other, so that nodes can be moved from other's tree
+* into this one. An arena without other handles is spliced into this one in O(chunks), and an empty arena simply
+* starts being shared. Returns false if other's arena is still in use elsewhere and the nodes have to be copied.
+*/
+template<typename T>
+bool PoolAllocator<T>::absorb(PoolAllocator<T>& other)
+{
+    if (other.mArena == NULL || other.mArena == mArena) {
+        return true;
+    }
+    if (mArena == NULL) {
+        mArena = other.mArena;
+        return true;
+    }
+    if (other.mArena.use_count() != 1) {
+        return false;
+    }
+
+    Arena& arena = *mArena;
+    Arena& donor = *other.mArena;
+    if (donor.mChunks != NULL) {
+        // Finding the oldest of the donor's chunks and hanging this arena's chunks behind it
+        Slot* oldest = donor.mChunks;
+        while (oldest->mNext != NULL) {
+            oldest = oldest->mNext;
+        }
+        oldest->mNext = arena.mChunks;
+        arena.mChunks = donor.mChunks;
+    }
+    if (donor.mFreeList != NULL) {
+        donor.mFreeTail->mNext = arena.mFreeList;
+        if (arena.mFreeList == NULL) {
+            arena.mFreeTail = donor.mFreeTail;
+        }
+        arena.mFreeList = donor.mFreeList;
+    }
+    // The donor's arena no longer owns anything, and the unused end of its newest chunk is simply given up
+    donor.mChunks = NULL;
+    donor.freeChunks();
+    other.mArena.reset();
+    return true;
+}
+
+/**
+* Constructor for an arena without any chunks.
+*/
+template<typename T>
+PoolAllocator<T>::Arena::Arena()
+        : mChunks(NULL)
+        , mFreeList(NULL)
+        , mFreeTail(NULL)
+        , mNextSlot(NULL)
+        , mEndSlot(NULL)
+        , mChunkSlots(FIRST_CHUNK_SLOTS)
+{
+
+}
+
+/**
+* Destructor, which frees every chunk of the arena.
+*/
+template<typename T>
+PoolAllocator<T>::Arena::~Arena()
+{
+    freeChunks();
+}
+
+/**
+* Allocates a new chunk, twice as large as the last one up to MAX_CHUNK_SLOTS, and links it into the chunk list.
+*/
+template<typename T>
+void PoolAllocator<T>::Arena::addChunk()
+{
+    Slot* chunk = new Slot[mChunkSlots + 1];
+    chunk->mNext = mChunks;
+    mChunks = chunk;
+    mNextSlot = chunk + 1;
+    mEndSlot = chunk + 1 + mChunkSlots;
+    if (mChunkSlots < MAX_CHUNK_SLOTS) {
+        mChunkSlots *= 2;
+    }
+}
+
+/**
+* Frees every chunk and resets the arena to its empty state.
+*/
+template<typename T>
+void PoolAllocator<T>::Arena::freeChunks()
+{
+    while (mChunks != NULL) {
+        Slot* previous = mChunks->mNext;
+        delete[] mChunks;
+        mChunks = previous;
+    }
+    mFreeList = NULL;
+    mFreeTail = NULL;
+    mNextSlot = NULL;
+    mEndSlot = NULL;
+    mChunkSlots = FIRST_CHUNK_SLOTS;
+}
+
+/*
+	------------------------------------------------
+	End implementations for the PoolAllocator class.
+	------------------------------------------------
+*/
+
+#endif
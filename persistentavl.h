@@ -0,0 +1,798 @@
+//
+// A persistent AVL tree whose readers take lock free snapshots while a writer keeps changing it.
+//
+
+#ifndef PERSISTENTAVL_H
+#define PERSISTENTAVL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "nodealloc.h"
+
+/**
+* A templated AVL tree in which a published Node is never changed. A write copies the Nodes on the path from the
+* root down to the change (and the few it rotates), links the copies into a new version of the tree, and publishes
+* the new root with one atomic store. Writers take turns on a mutex; readers take no lock at all.
+*
+* A reader calls snapshot(), which costs O(1), and can then search and iterate that version of the tree for as long
+* as it keeps the Snapshot, no matter what is written meanwhile. The Nodes that a write replaced are freed once no
+* Snapshot can still reach them, which is tracked with epochs: every write advances the epoch and tags the Nodes it
+* replaced with it, and every Snapshot announces the epoch it started in, in one of MAX_READERS slots.
+*
+* That makes MAX_READERS the limit on Snapshots alive at once, across all threads: snapshot() throws a
+* std::runtime_error rather than wait when every slot is taken, since a thread that holds them all itself would
+* otherwise wait forever.
+*
+* Unlike the AVLTree, Nodes have no parent pointers, since a shared Node would need one per version it is part of.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator>
+class PersistentAVLTree
+{
+private:
+    struct VersionNode
+    {
+        std::pair<Key, Value> mItem;
+        VersionNode* mLeft;
+        VersionNode* mRight;
+        int mHeight;
+        // The write that created the Node, which may change it in place until it is published
+        std::uint64_t mWrite;
+    };
+
+    // A Node that a write took out of the tree, to be freed when no Snapshot started before epoch can be reading
+    // it. A whole subtree is retired at once by clear().
+    struct Retired
+    {
+        std::uint64_t epoch;
+        VersionNode* node;
+        bool subtree;
+    };
+
+    // One slot per active Snapshot, holding the epoch it started in, or 0 if it is free. Each slot has a cache
+    // line to itself, so readers in different slots do not slow each other down.
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<std::uint64_t> mEpoch;
+    };
+
+public:
+    static const std::size_t MAX_READERS = 64;
+
+    PersistentAVLTree();
+    explicit PersistentAVLTree(const Compare& compare);
+    PersistentAVLTree(const PersistentAVLTree& other) = delete;
+    PersistentAVLTree& operator=(const PersistentAVLTree& other) = delete;
+    ~PersistentAVLTree();
+    void insert(const std::pair<Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    Compare key_comp() const;
+
+    /**
+    * An iterator for traversing the contents of one Snapshot in key order. Nodes have no parent pointers, so it
+    * keeps the path from the root down to its item.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::pair<Key, Value>* pointer;
+        typedef const std::pair<Key, Value>& reference;
+
+        iterator();
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        void pushLeft(const VersionNode* node);
+
+        // The Nodes whose items are still to come, with the current one on top
+        std::vector<const VersionNode*> mPath;
+
+        friend class PersistentAVLTree<Key, Value, Compare, Allocator>;
+    };
+
+    /**
+    * One version of the tree, which stays exactly as it was when snapshot() returned it. It occupies a reader slot
+    * and keeps the Nodes of its version alive until it is destroyed, so it should not be held longer than needed;
+    * there can be no more than MAX_READERS of them at once. Its iterators are only valid while it lives.
+    */
+    class Snapshot
+    {
+    public:
+        Snapshot(Snapshot&& other);
+        Snapshot(const Snapshot& other) = delete;
+        Snapshot& operator=(const Snapshot& other) = delete;
+        Snapshot& operator=(Snapshot&& other);
+        ~Snapshot();
+
+        iterator begin() const;
+        iterator end() const;
+        iterator find(const Key& key) const;
+        iterator lower_bound(const Key& key) const;
+        bool empty() const;
+
+    private:
+        Snapshot(const PersistentAVLTree* tree, std::size_t slot, const VersionNode* root);
+
+        const PersistentAVLTree* mTree;
+        std::size_t mSlot;
+        const VersionNode* mRoot;
+
+        friend class PersistentAVLTree<Key, Value, Compare, Allocator>;
+    };
+
+    Snapshot snapshot() const;
+
+private:
+    VersionNode* insertNode(VersionNode* root, const std::pair<Key, Value>& keyValuePair);
+    VersionNode* removeNode(VersionNode* root, const Key& key);
+    VersionNode* removeSmallest(VersionNode* root, std::pair<Key, Value>& item);
+    VersionNode* rebalance(VersionNode* root);
+    VersionNode* rotateLeft(VersionNode* root);
+    VersionNode* rotateRight(VersionNode* root);
+    static int height(const VersionNode* node);
+    static void updateHeight(VersionNode* node);
+    VersionNode* writable(VersionNode* node);
+    void retire(VersionNode* node, bool subtree);
+    void publish(VersionNode* root);
+    void reclaim();
+    void freeSubtree(VersionNode* root);
+    void destroyNode(VersionNode* node);
+
+    std::atomic<VersionNode*> mRoot;
+    std::atomic<std::uint64_t> mEpoch;
+    mutable ReaderSlot mReaders[MAX_READERS];
+
+    // Only touched by the writer holding mWriteLock
+    std::mutex mWriteLock;
+    std::uint64_t mWrite;
+    std::vector<VersionNode*> mReplaced;
+    std::deque<Retired> mRetired;
+    Compare mCompare;
+    Allocator<VersionNode> mAlloc;
+};
+
+/*
+	-----------------------------------------------------------------
+	Begin implementations for the PersistentAVLTree::iterator class.
+	-----------------------------------------------------------------
+*/
+
+/**
+* A default constructor for the end iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::iterator()
+{
+
+}
+
+/**
+* Provides access to the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+const std::pair<Key, Value>& PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::operator*() const
+{
+    return mPath.back()->mItem;
+}
+
+/**
+* Provides access to the address of the item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+const std::pair<Key, Value>* PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::operator->() const
+{
+    return &(mPath.back()->mItem);
+}
+
+/**
+* Checks if two iterators point at the same item.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::operator==(const iterator& rhs) const
+{
+    if (mPath.empty() || rhs.mPath.empty()) {
+        return mPath.empty() && rhs.mPath.empty();
+    }
+    return mPath.back() == rhs.mPath.back();
+}
+
+/**
+* Checks if two iterators point at different items.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator to the smallest key of the right subtree, or else back up to the closest Node that is
+* still to come.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::iterator& PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::operator++()
+{
+    auto current = mPath.back();
+    mPath.pop_back();
+    pushLeft(current->mRight);
+    return *this;
+}
+
+/**
+* A helper function that pushes a Node and its chain of left children.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::iterator::pushLeft(const VersionNode* node)
+{
+    while (node != NULL) {
+        mPath.push_back(node);
+        node = node->mLeft;
+    }
+}
+
+/*
+	---------------------------------------------------------------
+	End implementations for the PersistentAVLTree::iterator class.
+	---------------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------------------
+	Begin implementations for the PersistentAVLTree::Snapshot class.
+	-----------------------------------------------------------------
+*/
+
+/**
+* Constructor for a Snapshot of the version at root, which occupies the given reader slot.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::Snapshot(const PersistentAVLTree* tree, std::size_t slot, const VersionNode* root)
+        : mTree(tree)
+        , mSlot(slot)
+        , mRoot(root)
+{
+
+}
+
+/**
+* Move constructor, which takes over the reader slot of other.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::Snapshot(Snapshot&& other)
+        : mTree(other.mTree)
+        , mSlot(other.mSlot)
+        , mRoot(other.mRoot)
+{
+    other.mTree = NULL;
+}
+
+/**
+* Move assignment, which frees this Snapshot's reader slot and takes over the one of other.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot& PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::operator=(Snapshot&& other)
+{
+    if (&other == this) {
+        return *this;
+    }
+    if (mTree != NULL) {
+        mTree->mReaders[mSlot].mEpoch.store(0, std::memory_order_release);
+    }
+    mTree = other.mTree;
+    mSlot = other.mSlot;
+    mRoot = other.mRoot;
+    other.mTree = NULL;
+    return *this;
+}
+
+/**
+* Destructor, which frees the reader slot, so that the Nodes only this Snapshot could reach can be freed.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::~Snapshot()
+{
+    if (mTree != NULL) {
+        mTree->mReaders[mSlot].mEpoch.store(0, std::memory_order_release);
+    }
+}
+
+/**
+* Returns an iterator to the smallest key of the Snapshot.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::iterator PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::begin() const
+{
+    iterator it;
+    it.pushLeft(mRoot);
+    return it;
+}
+
+/**
+* Returns the iterator past the largest key.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::iterator PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or the end iterator if the Snapshot does not have it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::iterator PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::find(const Key& key) const
+{
+    auto it = lower_bound(key);
+    if (it != end() && mTree->mCompare(key, it->first)) {
+        return end();
+    }
+    return it;
+}
+
+/**
+* Returns an iterator to the first item whose key is not smaller than the given key, or the end iterator. The
+* Nodes where the walk down turns left are the ones still to come after it.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::iterator PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::lower_bound(const Key& key) const
+{
+    iterator it;
+    auto node = mRoot;
+    while (node != NULL) {
+        if (mTree->mCompare(node->mItem.first, key)) {
+            node = node->mRight;
+        } else {
+            it.mPath.push_back(node);
+            node = node->mLeft;
+        }
+    }
+    return it;
+}
+
+/**
+* Returns true if the Snapshot has no items.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot::empty() const
+{
+    return mRoot == NULL;
+}
+
+/*
+	---------------------------------------------------------------
+	End implementations for the PersistentAVLTree::Snapshot class.
+	---------------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the PersistentAVLTree class.
+	-----------------------------------------------------
+*/
+
+/**
+* Default constructor for an empty tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::PersistentAVLTree()
+        : mRoot(NULL)
+        , mEpoch(1)
+        , mWrite(0)
+        , mCompare()
+{
+    for (std::size_t i = 0; i < MAX_READERS; i++) {
+        mReaders[i].mEpoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Constructor for an empty tree that orders its keys with the given Compare.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::PersistentAVLTree(const Compare& compare)
+        : mRoot(NULL)
+        , mEpoch(1)
+        , mWrite(0)
+        , mCompare(compare)
+{
+    for (std::size_t i = 0; i < MAX_READERS; i++) {
+        mReaders[i].mEpoch.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Destructor, which frees every version. No Snapshot may outlive the tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+PersistentAVLTree<Key, Value, Compare, Allocator>::~PersistentAVLTree()
+{
+    freeSubtree(mRoot.load(std::memory_order_relaxed));
+    for (auto& retired : mRetired) {
+        if (retired.subtree) {
+            freeSubtree(retired.node);
+        } else {
+            destroyNode(retired.node);
+        }
+    }
+}
+
+/**
+* Inserts a key-value pair, overwriting the value if the key is already in the tree, and publishes the result as
+* a new version. Snapshots that were taken before keep seeing the old version.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    mWrite++;
+    publish(insertNode(mRoot.load(std::memory_order_relaxed), keyValuePair));
+}
+
+/**
+* Removes the item with the given key, if there is one, and publishes the result as a new version.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::remove(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    auto root = mRoot.load(std::memory_order_relaxed);
+
+    // Looking first, so that removing a missing key does not copy a path for nothing
+    auto node = root;
+    while (node != NULL) {
+        if (mCompare(key, node->mItem.first)) {
+            node = node->mLeft;
+        } else if (mCompare(node->mItem.first, key)) {
+            node = node->mRight;
+        } else {
+            break;
+        }
+    }
+    if (node == NULL) {
+        return;
+    }
+    mWrite++;
+    publish(removeNode(root, key));
+}
+
+/**
+* Publishes an empty version. The old Nodes are freed as a whole once no Snapshot can reach them.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::clear()
+{
+    std::lock_guard<std::mutex> lock(mWriteLock);
+    auto root = mRoot.load(std::memory_order_relaxed);
+    if (root == NULL) {
+        return;
+    }
+    mWrite++;
+    retire(root, true);
+    publish(NULL);
+}
+
+/**
+* Returns a copy of the Compare that orders the keys.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+Compare PersistentAVLTree<Key, Value, Compare, Allocator>::key_comp() const
+{
+    return mCompare;
+}
+
+/**
+* Returns a Snapshot of the latest version. It claims a reader slot with the current epoch before it reads the
+* root, so no Node that the root can reach is freed until the Snapshot is gone. Throws a std::runtime_error if all
+* MAX_READERS slots are taken.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::Snapshot PersistentAVLTree<Key, Value, Compare, Allocator>::snapshot() const
+{
+    // Threads start looking at different slots, so that they rarely compete for the same one
+    std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS;
+    for (std::size_t i = 0; i < MAX_READERS; i++) {
+        std::size_t slot = (start + i) % MAX_READERS;
+        std::uint64_t free = 0;
+        if (mReaders[slot].mEpoch.load(std::memory_order_relaxed) == 0
+                && mReaders[slot].mEpoch.compare_exchange_strong(free, mEpoch.load())) {
+            return Snapshot(this, slot, mRoot.load());
+        }
+    }
+    throw std::runtime_error("PersistentAVLTree::snapshot(): all reader slots are taken");
+}
+
+/**
+* A helper function for insert() that returns the new root of a subtree with the pair inserted. The Nodes on the
+* way down are replaced by writable copies, and each level is rebalanced on the way back up. The recursion is
+* bounded by the height of an AVL tree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::insertNode(VersionNode* root, const std::pair<Key, Value>& keyValuePair)
+{
+    if (root == NULL) {
+        VersionNode* node = mAlloc.allocate();
+        try {
+            new (node) VersionNode{keyValuePair, NULL, NULL, 1, mWrite};
+        } catch (...) {
+            mAlloc.deallocate(node);
+            throw;
+        }
+        return node;
+    }
+
+    root = writable(root);
+    if (mCompare(keyValuePair.first, root->mItem.first)) {
+        root->mLeft = insertNode(root->mLeft, keyValuePair);
+    } else if (mCompare(root->mItem.first, keyValuePair.first)) {
+        root->mRight = insertNode(root->mRight, keyValuePair);
+    } else {
+        // If the keys are the same, override the current value
+        root->mItem.second = keyValuePair.second;
+        return root;
+    }
+    return rebalance(root);
+}
+
+/**
+* A helper function for remove() that returns the new root of a subtree with the key removed. The key has to be
+* in the subtree. A Node with two children takes over a copy of the smallest item of its right subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::removeNode(VersionNode* root, const Key& key)
+{
+    if (mCompare(key, root->mItem.first)) {
+        root = writable(root);
+        root->mLeft = removeNode(root->mLeft, key);
+        return rebalance(root);
+    }
+    if (mCompare(root->mItem.first, key)) {
+        root = writable(root);
+        root->mRight = removeNode(root->mRight, key);
+        return rebalance(root);
+    }
+
+    if (root->mLeft == NULL || root->mRight == NULL) {
+        auto child = (root->mLeft != NULL) ? root->mLeft : root->mRight;
+        retire(root, false);
+        return child;
+    }
+    root = writable(root);
+    root->mRight = removeSmallest(root->mRight, root->mItem);
+    return rebalance(root);
+}
+
+/**
+* A helper function that takes the smallest Node out of a subtree, copies its item into item, and returns the
+* new root of the subtree. The Node may still be read by a Snapshot, so its item is copied rather than moved.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::removeSmallest(VersionNode* root, std::pair<Key, Value>& item)
+{
+    if (root->mLeft == NULL) {
+        item = root->mItem;
+        auto right = root->mRight;
+        retire(root, false);
+        return right;
+    }
+    root = writable(root);
+    root->mLeft = removeSmallest(root->mLeft, item);
+    return rebalance(root);
+}
+
+/**
+* A helper function that restores the AVL balance of a writable Node whose subtrees differ in height by at most
+* two, and returns the new root of its subtree.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::rebalance(VersionNode* root)
+{
+    int balance = height(root->mLeft) - height(root->mRight);
+    if (balance > 1) {
+        if (height(root->mLeft->mLeft) < height(root->mLeft->mRight)) {
+            root->mLeft = rotateLeft(writable(root->mLeft));
+        }
+        return rotateRight(root);
+    }
+    if (balance < -1) {
+        if (height(root->mRight->mRight) < height(root->mRight->mLeft)) {
+            root->mRight = rotateRight(writable(root->mRight));
+        }
+        return rotateLeft(root);
+    }
+    updateHeight(root);
+    return root;
+}
+
+/**
+* Rotates a writable Node to the left, and returns the (writable) Node that takes its place.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::rotateLeft(VersionNode* root)
+{
+    auto rightChild = writable(root->mRight);
+    root->mRight = rightChild->mLeft;
+    rightChild->mLeft = root;
+    updateHeight(root);
+    updateHeight(rightChild);
+    return rightChild;
+}
+
+/**
+* Rotates a writable Node to the right, and returns the (writable) Node that takes its place.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::rotateRight(VersionNode* root)
+{
+    auto leftChild = writable(root->mLeft);
+    root->mLeft = leftChild->mRight;
+    leftChild->mRight = root;
+    updateHeight(root);
+    updateHeight(leftChild);
+    return leftChild;
+}
+
+/**
+* Returns the height of a Node, where an empty subtree has height 0.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+int PersistentAVLTree<Key, Value, Compare, Allocator>::height(const VersionNode* node)
+{
+    return (node == NULL) ? 0 : node->mHeight;
+}
+
+/**
+* Recomputes the height of a Node from its children.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::updateHeight(VersionNode* node)
+{
+    int left = height(node->mLeft);
+    int right = height(node->mRight);
+    node->mHeight = 1 + ((left > right) ? left : right);
+}
+
+/**
+* Returns a Node that the current write may change: the Node itself if this write created it, otherwise a copy,
+* in which case the original is retired.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename PersistentAVLTree<Key, Value, Compare, Allocator>::VersionNode* PersistentAVLTree<Key, Value, Compare, Allocator>::writable(VersionNode* node)
+{
+    if (node->mWrite == mWrite) {
+        return node;
+    }
+    VersionNode* copy = mAlloc.allocate();
+    try {
+        new (copy) VersionNode{node->mItem, node->mLeft, node->mRight, node->mHeight, mWrite};
+    } catch (...) {
+        mAlloc.deallocate(copy);
+        throw;
+    }
+    retire(node, false);
+    return copy;
+}
+
+/**
+* Takes a Node out of the current write's version. A Node this write created was never published, so it is
+* freed right away; any other one is kept until the write is published.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::retire(VersionNode* node, bool subtree)
+{
+    if (!subtree && node->mWrite == mWrite) {
+        destroyNode(node);
+        return;
+    }
+    if (subtree) {
+        mRetired.push_back(Retired{0, node, true});
+    } else {
+        mReplaced.push_back(node);
+    }
+}
+
+/**
+* Makes root the latest version, then advances the epoch and tags the Nodes this write replaced with it. A
+* Snapshot that announces the new epoch or a later one reads the root after it was published, so it cannot reach
+* them.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::publish(VersionNode* root)
+{
+    mRoot.store(root);
+    std::uint64_t epoch = mEpoch.fetch_add(1) + 1;
+    for (auto it = mRetired.rbegin(); it != mRetired.rend() && it->epoch == 0; ++it) {
+        it->epoch = epoch;
+    }
+    for (auto node : mReplaced) {
+        mRetired.push_back(Retired{epoch, node, false});
+    }
+    mReplaced.clear();
+    reclaim();
+}
+
+/**
+* Frees the retired Nodes that no Snapshot can reach any more, which are those retired in an epoch no later than
+* the oldest epoch a reader slot still announces.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::reclaim()
+{
+    std::uint64_t oldest = mEpoch.load();
+    for (std::size_t i = 0; i < MAX_READERS; i++) {
+        std::uint64_t epoch = mReaders[i].mEpoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    while (!mRetired.empty() && mRetired.front().epoch <= oldest) {
+        if (mRetired.front().subtree) {
+            freeSubtree(mRetired.front().node);
+        } else {
+            destroyNode(mRetired.front().node);
+        }
+        mRetired.pop_front();
+    }
+}
+
+/**
+* Frees every Node of a subtree that no version shares any more, without recursion.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::freeSubtree(VersionNode* root)
+{
+    std::vector<VersionNode*> stack;
+    if (root != NULL) {
+        stack.push_back(root);
+    }
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (node->mLeft != NULL) {
+            stack.push_back(node->mLeft);
+        }
+        if (node->mRight != NULL) {
+            stack.push_back(node->mRight);
+        }
+        destroyNode(node);
+    }
+}
+
+/**
+* Destroys a Node and gives it back to the allocator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void PersistentAVLTree<Key, Value, Compare, Allocator>::destroyNode(VersionNode* node)
+{
+    node->~VersionNode();
+    mAlloc.deallocate(node);
+}
+
+/*
+	---------------------------------------------------
+	End implementations for the PersistentAVLTree class.
+	---------------------------------------------------
+*/
+
+#endif
@@ -7,268 +7,259 @@
 
 #include "bst.h"
 
-template <typename Key, typename Value>
-class rotateBST : public BinarySearchTree <Key, Value> {
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator, typename NodeType = Node<Key, Value> >
+class rotateBST : public BinarySearchTree <Key, Value, Compare, Allocator, NodeType> {
 
     public:
         rotateBST();
+        explicit rotateBST(const Compare& compare);
+        rotateBST(const rotateBST& other);
+        rotateBST(rotateBST&& other) noexcept;
         ~rotateBST();
-        bool sameKeys(const rotateBST& t2);
-        void transform(rotateBST& t2);
-
-    protected:
-        void leftRotate(Node<Key, Value>* r);
-        void rightRotate(Node <Key, Value>* r);
-
+        rotateBST& operator=(const rotateBST& other);
+        rotateBST& operator=(rotateBST&& other) noexcept;
+        bool sameKeys(const rotateBST& t2) const;
+
+        /**
+        * What transform() did, or would do in a dry run. keysMatch is false if the trees have different keys, in
+        * which case nothing else happened.
+        */
+        struct TransformStats
+        {
+            bool keysMatch;
+            std::size_t rotations;
+            std::size_t nodesVisited;
+        };
+
+        TransformStats transform(rotateBST& t2, bool dryRun = false);
 
     private:
-        bool checkEqual(const rotateBST& t2, Node<Key, Value>* r);
-        bool isEqual(const rotateBST<Key,Value>& t2, Node<Key, Value>* r);
-        void transformRightRecursive(rotateBST& t2, Node<Key, Value>* r);
-        void transformLeftRecursive(rotateBST<Key,Value>& t2, Node<Key, Value>* r1, Node<Key, Value>* r2);
-        void transformRightRecursive(rotateBST<Key,Value>& t2, Node<Key, Value>* r1, Node<Key, Value>* r2);
-
+        bool sameSize(const rotateBST& t2, std::true_type hasSizes) const;
+        bool sameSize(const rotateBST& t2, std::false_type hasSizes) const;
+        std::size_t makeVine(std::size_t& visited);
+        std::size_t shapeVine(const rotateBST& shape, std::size_t& visited);
+        static std::size_t vineDistance(Node<Key, Value>* root, std::size_t& visited);
+        static Node<Key, Value>* nextInOrder(Node<Key, Value>* node);
 
 };
 
 /**
 * Constructor
 */
-template<typename Key, typename Value>
-rotateBST<Key,Value>::rotateBST() {
-    BinarySearchTree<Key, Value>();
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>::rotateBST() {
+    BinarySearchTree<Key, Value, Compare, Allocator, NodeType>();
 }
 
 /**
-* Deconstructor
+* Constructor for a tree that orders its keys with the given Compare
 */
-template<typename Key, typename Value>
-rotateBST<Key,Value>::~rotateBST() {
-    this->clear();
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>::rotateBST(const Compare& compare)
+        : BinarySearchTree<Key, Value, Compare, Allocator, NodeType>(compare)
+{
+
 }
 
 /**
-* Rotates the tree to the right from a root Node.
+* Copy constructor, see BinarySearchTree
 */
-template<typename Key, typename Value>
-void rotateBST<Key, Value>::rightRotate(Node<Key, Value>* r) {
-    // If the left side is empty, no rotation
-    if (r->getLeft() == NULL) {
-        return;
-    }
-
-    // Finding the three key players in the rotation
-    auto leftChild = r->getLeft();
-    auto leftRightChild = leftChild->getRight();
-    auto parent = r->getParent();
-
-    // Changing the Pointers accordingly
-    r->setLeft(leftRightChild);         // leftRightChild becomes the child of the root instead of leftChild
-    r->setParent(leftChild);            // leftChild becomes the parent of the root instead of being the left child
-    leftChild->setRight(r);             // root becomes the right child of the leftChild
-    leftChild->setParent(parent);       // root's parent becomes the parent of the leftChild instead of root
-
-    // Changing the main root if necessary
-    if (r == this->mRoot) {
-        this->mRoot = leftChild;
-    }
-    // If the leftRightChild exists, set its parent to the root
-    if (leftRightChild != NULL) {
-        leftRightChild->setParent(r);
-    }
-    // If the root has a parent, then set the parent's new left or right child
-    if (parent != NULL){
-        if (parent->getLeft() == r) {
-            parent->setLeft(leftChild);
-        } else {
-            parent->setRight(leftChild);
-        }
-    }
-
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>::rotateBST(const rotateBST& other)
+        : BinarySearchTree<Key, Value, Compare, Allocator, NodeType>(other)
+{
 
 }
 
 /**
-* Rotates the tree to the left from a root Node.
+* Move constructor, see BinarySearchTree
 */
-template<typename Key, typename Value>
-void rotateBST<Key, Value>::leftRotate(Node<Key, Value>* r) {
-    // If the right side is empty, no rotation
-    if (r->getRight() == NULL) {
-        return;
-    }
-
-    // Finding the three key players in the rotation
-    auto rightChild = r->getRight();
-    auto rightLeftChild = rightChild->getLeft();
-    auto parent = r->getParent();
-
-    // Changing the Pointers accordingly
-    r->setRight(rightLeftChild);        // rightLeftChild becomes the right child of root, replacing rightChild
-    r->setParent(rightChild);           // rightChild becomes the parent of root, replacing parent
-    rightChild->setLeft(r);             // root becomes the left child of rightChild, replacing rightLeftChild
-    rightChild->setParent(parent);      // parent becomes the parent of rightChild, replacing root
-
-    // Changing the main root if necessary
-    if (r == this->mRoot) {
-        this->mRoot = rightChild;
-    }
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>::rotateBST(rotateBST&& other) noexcept
+        : BinarySearchTree<Key, Value, Compare, Allocator, NodeType>(std::move(other))
+{
 
-    // If the rightLeftChild exists, set its parent to the root
-    if (rightLeftChild != NULL) {
-        rightLeftChild->setParent(r);
-    }
-    // If the root has a parent, then set the parent's new left or right child
-    if (parent != NULL){
-        if (parent->getLeft() == r) {
-            parent->setLeft(rightChild);
-        } else {
-            parent->setRight(rightChild);
-        }
-    }
+}
 
+/**
+* Deconstructor
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>::~rotateBST() {
+    this->clear();
 }
 
 /**
-* Checks if two Rotate Binary Search Trees have an identical set of keys.
- * NOTE: Possibly could be more efficient
+* Copy assignment, see BinarySearchTree
 */
-template<typename Key, typename Value>
-bool rotateBST<Key,Value>::sameKeys(const rotateBST<Key,Value>& t2) {
-    return (checkEqual(t2, this->mRoot) && checkEqual(*this, t2.mRoot));
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>& rotateBST<Key, Value, Compare, Allocator, NodeType>::operator=(const rotateBST& other) {
+    BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::operator=(other);
+    return *this;
 }
 
 /**
-* A recursive helper function for sameKeys that goes through the tree to every Node and tries to find it in
- * the other tree
+* Move assignment, see BinarySearchTree
 */
-template<typename Key, typename Value>
-bool rotateBST<Key,Value>::checkEqual(const rotateBST<Key,Value>& t2, Node<Key, Value>* r) {
-    // Need to check right tree and left tree
-    bool rightCheck;
-    bool leftCheck;
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+rotateBST<Key, Value, Compare, Allocator, NodeType>& rotateBST<Key, Value, Compare, Allocator, NodeType>::operator=(rotateBST&& other) noexcept {
+    BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::operator=(std::move(other));
+    return *this;
+}
 
-    // If there is a left subtree, keep following it
-    if (r->getLeft() != NULL) {
-        leftCheck = checkEqual(t2, r->getLeft());
-    } else {
-        leftCheck = true;  // Means we have reached a lead node on the left side
+/**
+* Checks if two Rotate Binary Search Trees have an identical set of keys. Walks both trees in order side by side,
+ * so it takes O(n) time and no extra space, and stops at the first key that differs. Trees that keep subtree sizes
+ * are first compared by size.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool rotateBST<Key, Value, Compare, Allocator, NodeType>::sameKeys(const rotateBST<Key, Value, Compare, Allocator, NodeType>& t2) const {
+    if (!sameSize(t2, std::integral_constant<bool, BinarySearchTree<Key, Value, Compare, Allocator, NodeType>::HAS_SIZES>())) {
+        return false;
     }
 
-    // If there is a right subtree, keep following it
-    if (r->getRight() != NULL) {
-        rightCheck = checkEqual(t2, r->getRight());
-    } else {
-        rightCheck = true; // Means we have reached a leaf node on the right side
+    auto mine = this->begin();
+    auto theirs = t2.begin();
+    while (mine != this->end() && theirs != t2.end()) {
+        if (this->compareKeys(mine->first, theirs->first) != 0) {
+            return false;
+        }
+        ++mine;
+        ++theirs;
     }
+    // Both have to run out at the same time, otherwise one tree has keys the other does not
+    return mine == this->end() && theirs == t2.end();
+}
 
-    // Checks that for the value in the other tree, accounting for the left and right subtrees as well
-    // Makes sure that if the result is false for either right or left subtree, the entire result is false
-    return (isEqual(t2, r) && rightCheck && leftCheck);
+/**
+* A helper function for sameKeys that compares the sizes of two trees whose Nodes keep subtree sizes, in O(1).
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool rotateBST<Key, Value, Compare, Allocator, NodeType>::sameSize(const rotateBST<Key, Value, Compare, Allocator, NodeType>& t2, std::true_type /* hasSizes */) const {
+    return this->size() == t2.size();
 }
 
 /**
-* A helper function for isEqual that takes a Node and checks specifically if it is in the other tree, returning
- * true or false
+* A helper function for sameKeys for trees whose Nodes keep no sizes, which leaves the walk to find any difference.
 */
-template<typename Key, typename Value>
-bool rotateBST<Key,Value>::isEqual(const rotateBST<Key,Value>& t2, Node<Key, Value>* r) {
-    // Finds the value in the other tree
-    auto find = t2.internalFind(r->getKey());
-    if (find == NULL){
-        return false;
-    }
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+bool rotateBST<Key, Value, Compare, Allocator, NodeType>::sameSize(const rotateBST<Key, Value, Compare, Allocator, NodeType>& /* t2 */, std::false_type /* hasSizes */) const {
     return true;
 }
 
 /**
-* Takes a rotateBST and transforms it to match the current rotateBST using rotations
+* Takes a rotateBST and transforms it to match the current rotateBST using rotations. The given tree is first
+ * rotated into a vine (a linked list down right children), and the vine is then rotated into this tree's shape, so
+ * it takes at most 2n rotations and O(n) time, with no recursion or extra space. With dryRun, neither tree changes
+ * and the returned rotations are the ones a real transform would do.
 */
-template<typename Key, typename Value>
-void rotateBST<Key,Value>::transform(rotateBST<Key,Value>& t2){
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+typename rotateBST<Key, Value, Compare, Allocator, NodeType>::TransformStats
+rotateBST<Key, Value, Compare, Allocator, NodeType>::transform(rotateBST<Key, Value, Compare, Allocator, NodeType>& t2, bool dryRun){
+    TransformStats stats = {false, 0, 0};
     // Exits function if the keys are not the same
     if (!this->sameKeys(t2)) {
-        return;
+        return stats;
     }
+    stats.keysMatch = true;
 
-    transformRightRecursive(t2, t2.mRoot);              // First converts given tree to a linked list
-    transformLeftRecursive(t2, this->mRoot,t2.mRoot);   // Then recursively converts into this tree
-
+    if (dryRun) {
+        // Both halves rotate once for every Node that is off the right spine of its tree
+        stats.rotations = vineDistance(t2.mRoot, stats.nodesVisited) + vineDistance(this->mRoot, stats.nodesVisited);
+    } else {
+        stats.rotations = t2.makeVine(stats.nodesVisited);             // First converts given tree to a linked list
+        stats.rotations += t2.shapeVine(*this, stats.nodesVisited);    // Then converts it into this tree
+    }
+    return stats;
 }
 
 /**
-* Takes a rotateBST and transforms it into a linked list
+* A helper function to transform() that rotates the tree into a vine, walking down the right spine and rotating
+ * right until each Node there has no left child. Every rotation adds one Node to the spine, so it takes n minus
+ * the length of the original spine rotations. Returns the number of rotations.
 */
-template<typename Key, typename Value>
-void rotateBST<Key,Value>::transformRightRecursive(rotateBST<Key,Value>& t2, Node<Key, Value>* r){
-    // Keep rotating to the left until there is no left children
-    while (r->getLeft() != NULL) {
-        t2.rightRotate(r);
-        r = r->getParent();
-    }
-
-    // If there are no more right Nodes to rotate, exit the function
-    if (r->getRight() == NULL) {
-        return;
-    } else {
-        transformRightRecursive(t2, r->getRight());
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::size_t rotateBST<Key, Value, Compare, Allocator, NodeType>::makeVine(std::size_t& visited){
+    std::size_t rotations = 0;
+    Node<Key, Value>* r = this->mRoot;
+    while (r != NULL) {
+        // Keep rotating to the right until there is no left child
+        while (r->getLeft() != NULL) {
+            this->rightRotate(r);
+            r = r->getParent();
+            rotations++;
+        }
+        visited++;
+        r = r->getRight();
     }
+    return rotations;
 }
 
 /**
-* A helper function to transform() that takes a rotateBST and rotates it to the right recursively
+* A helper function to transform() that rotates a vine into the shape of another tree with the same keys. It
+ * goes through the shape in order, and once the Nodes before a key are in shape along the vine, the matching
+ * vine Node only has to be rotated left over the right spine of its left subtree, which then hangs off it.
+ * Every rotation takes one Node off the spine for good, so it takes n minus the length of the shape's spine
+ * rotations. Returns the number of rotations.
 */
-template<typename Key, typename Value>
-void rotateBST<Key,Value>::transformRightRecursive(rotateBST<Key,Value>& t2, Node<Key, Value>* r1, Node<Key, Value>* r2){
-    // If the two Nodes do not equal, rotate the tree to the right until they do
-    while (r1->getKey() != r2->getKey()) {
-        t2.rightRotate(r2);
-        r2 = r2->getParent();
-    }
-
-    // Check if there is a right child to r2
-    if (r2->getRight() != NULL) {
-        // First check if those keys equal, otherwise move recursively on the left side to transform
-        if (r2->getRight()->getKey() != r1->getRight()->getKey() || r2->getRight()->getRight() != NULL)
-            transformLeftRecursive(t2, r1->getRight(), r2->getRight());
-    }
-
-    // Check if there is a left child to r2
-    if (r2->getLeft() != NULL) {
-        // First check if those keys equal, otherwise move recursively on the right side to transform
-        if (r2->getLeft()->getKey() != r1->getLeft()->getKey() || r2->getLeft()->getLeft() != NULL){
-            transformRightRecursive(t2, r1->getLeft(), r2->getLeft()) ;
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::size_t rotateBST<Key, Value, Compare, Allocator, NodeType>::shapeVine(const rotateBST<Key, Value, Compare, Allocator, NodeType>& shape, std::size_t& visited){
+    std::size_t rotations = 0;
+    // The vine Node with the same key as target, found by walking this tree in order alongside the shape
+    Node<Key, Value>* r = this->getSmallestNode();
+    for (Node<Key, Value>* target = shape.getSmallestNode(); target != NULL; target = nextInOrder(target)) {
+        for (Node<Key, Value>* spine = target->getLeft(); spine != NULL; spine = spine->getRight()) {
+            this->leftRotate(r->getParent());
+            rotations++;
+            visited++;
         }
+        visited += 2;
+        r = nextInOrder(r);
     }
+    return rotations;
 }
 
 /**
-* A helper function to transform() that takes a rotateBST and rotates it to the left recursively
+* A helper function to transform() that counts the rotations between a tree and a vine, which is the length of
+ * the right spine of every left subtree added up.
 */
-template<typename Key, typename Value>
-void rotateBST<Key,Value>::transformLeftRecursive(rotateBST<Key,Value>& t2, Node<Key, Value>* r1, Node<Key, Value>* r2){
-
-    // If the two Nodes do not equal, rotate the tree to the left until they do
-    while (r1->getKey() != r2->getKey()) {
-        t2.leftRotate(r2);
-        r2 = r2->getParent();
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+std::size_t rotateBST<Key, Value, Compare, Allocator, NodeType>::vineDistance(Node<Key, Value>* root, std::size_t& visited){
+    std::size_t rotations = 0;
+    Node<Key, Value>* r = root;
+    while (r != NULL && r->getLeft() != NULL) {
+        r = r->getLeft();
     }
-
-    // Check if there is right child to r2
-    if (r2->getRight() != NULL) {
-        // First check if those keys equal, otherwise move recursively on the left side to transform
-        if (r2->getRight()->getKey() != r1->getRight()->getKey()|| r2->getRight()->getRight() != NULL)
-            transformLeftRecursive(t2, r1->getRight(), r2->getRight());
+    for (; r != NULL; r = nextInOrder(r)) {
+        for (Node<Key, Value>* spine = r->getLeft(); spine != NULL; spine = spine->getRight()) {
+            rotations++;
+            visited++;
+        }
+        visited++;
     }
+    return rotations;
+}
 
-    // Check if there is a left child to r2
-    if (r2->getLeft() != NULL) {
-        // First check if those keys equal, otherwise move recursively on the right side to transform
-        if (r2->getLeft()->getKey() != r1->getLeft()->getKey() || r2->getLeft()->getLeft() != NULL){
-            transformRightRecursive(t2, r1->getLeft(), r2->getLeft());
+/**
+* A helper function that returns the Node after the given one in order, or NULL after the last one. Like the
+ * iterator, it only follows parent pointers.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator, typename NodeType>
+Node<Key, Value>* rotateBST<Key, Value, Compare, Allocator, NodeType>::nextInOrder(Node<Key, Value>* node){
+    if (node->getRight() != NULL) {
+        node = node->getRight();
+        while (node->getLeft() != NULL) {
+            node = node->getLeft();
         }
+        return node;
     }
-
+    Node<Key, Value>* parent = node->getParent();
+    while (parent != NULL && node == parent->getRight()) {
+        node = parent;
+        parent = parent->getParent();
+    }
+    return parent;
 }
 
 
@@ -0,0 +1,661 @@
+//
+// A container that splits its keys by range across several AVL trees, each behind a lock of its own. Unlike the
+// other headers it needs C++17, for std::shared_mutex.
+//
+
+#ifndef SHARDEDTREE_H
+#define SHARDEDTREE_H
+
+#if __cplusplus < 201703L
+#error "shardedtree.h needs C++17 (std::shared_mutex), compile with -std=c++17 or later"
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "avlbst.h"
+
+/**
+* An ordered map made of shards: AVL trees that each own one range of keys, cut at a sorted list of boundary keys.
+* Every shard has its own reader-writer lock, so writers to different ranges never wait for each other, and
+* batches, range scans, bulk loads and clear() run one task per shard in parallel.
+*
+* A shard that holds too large a share of the keys is split at its median in O(log n), and when that leaves too
+* many shards the two smallest neighbours are joined back together. The shards keep subtree sizes, which makes
+* finding the median a single walk. rebalance() evens out every shard at once. Changing the boundaries takes an
+* exclusive lock on the list of shards, which every other operation holds shared.
+*
+* The iterators walk the shards in key order, one after the other, and are only safe while no other thread is
+* changing the container.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          template <typename> class Allocator = NodeAllocator>
+class ShardedTree
+{
+public:
+    typedef AVLNode<Key, Value, SizedNode<Key, Value> > NodeType;
+    typedef AVLTree<Key, Value, Compare, Allocator, NodeType> ShardType;
+
+    // Splitting a shard leaves both halves with the same allocator, which may then be used by two threads at once
+    static_assert(Allocator<NodeType>::THREAD_SAFE, "ShardedTree needs a thread safe allocator");
+
+    explicit ShardedTree(std::size_t shards = std::thread::hardware_concurrency(), const Compare& compare = Compare());
+    ShardedTree(const ShardedTree& other) = delete;
+    ShardedTree& operator=(const ShardedTree& other) = delete;
+
+    void insert(const std::pair<Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value) const;
+    void clear();
+    std::size_t size() const;
+    bool empty() const;
+    std::size_t shardCount() const;
+    Compare key_comp() const;
+
+    // Methods that split their work by shard and hand each shard's part to a task of its own
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    void insertBatch(InputIterator first, InputIterator last);
+    template <typename InputIterator>
+    void eraseBatch(InputIterator first, InputIterator last);
+    template <typename Function>
+    void scan(const Key& lo, const Key& hi, Function function) const;
+
+    // Moves the boundaries so that every shard holds about the same number of keys
+    void rebalance();
+
+    /**
+    * An iterator over every item of every shard in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<Key, Value>* pointer;
+        typedef std::pair<Key, Value>& reference;
+
+        iterator();
+
+        std::pair<Key, Value>& operator*() const;
+        std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        iterator(const ShardedTree* tree, std::size_t shard, typename ShardType::iterator current);
+        void skipEmptyShards();
+
+        const ShardedTree* mTree;
+        std::size_t mShard;
+        typename ShardType::iterator mCurrent;
+
+        friend class ShardedTree<Key, Value, Compare, Allocator>;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator lower_bound(const Key& key) const;
+
+private:
+    struct Shard
+    {
+        explicit Shard(const Compare& compare);
+
+        mutable std::shared_mutex mLock;
+        ShardType mTree;
+    };
+
+    std::size_t shardOf(const Key& key) const;
+    bool isSkewed(std::size_t shardSize) const;
+    void splitShard(const Key& key);
+    void joinSmallestNeighbours(std::size_t splitShard);
+    template <typename Function>
+    void forEachShard(std::size_t first, std::size_t last, Function function) const;
+
+    // No shard is split while it holds fewer keys than this, nor while it holds less than SKEW_FACTOR times its
+    // share of the keys
+    static const std::size_t MIN_SPLIT_SIZE = 1024;
+    static const std::size_t SKEW_FACTOR = 2;
+
+    // mBounds[i] is the smallest key that belongs to mShards[i + 1]
+    std::vector<std::unique_ptr<Shard> > mShards;
+    std::vector<Key> mBounds;
+    std::size_t mTargetShards;
+    std::atomic<std::size_t> mSize;
+    mutable std::shared_mutex mDirectoryLock;
+    Compare mCompare;
+};
+
+/*
+	----------------------------------------------------------
+	Begin implementations for the ShardedTree::iterator class.
+	----------------------------------------------------------
+*/
+
+/**
+* Default constructor for an iterator that points nowhere.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ShardedTree<Key, Value, Compare, Allocator>::iterator::iterator()
+        : mTree(NULL), mShard(0)
+{
+
+}
+
+/**
+* Constructor for an iterator at a position in one of the shards, which moves on to the next shard if that
+* position is the shard's end.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ShardedTree<Key, Value, Compare, Allocator>::iterator::iterator(const ShardedTree* tree, std::size_t shard,
+                                                                typename ShardType::iterator current)
+        : mTree(tree), mShard(shard), mCurrent(current)
+{
+    skipEmptyShards();
+}
+
+/**
+* Dereferences the iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::pair<Key, Value>& ShardedTree<Key, Value, Compare, Allocator>::iterator::operator*() const
+{
+    return *mCurrent;
+}
+
+/**
+* Dereferences the iterator.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::pair<Key, Value>* ShardedTree<Key, Value, Compare, Allocator>::iterator::operator->() const
+{
+    return &(*mCurrent);
+}
+
+/**
+* Checks if 'this' iterator's internals have the same value as 'rhs'.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ShardedTree<Key, Value, Compare, Allocator>::iterator::operator==(const iterator& rhs) const
+{
+    return mShard == rhs.mShard && mCurrent == rhs.mCurrent;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value than 'rhs'.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ShardedTree<Key, Value, Compare, Allocator>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Advances the iterator's location, moving on to the next shard at the end of one.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename ShardedTree<Key, Value, Compare, Allocator>::iterator& ShardedTree<Key, Value, Compare, Allocator>::iterator::operator++()
+{
+    ++mCurrent;
+    skipEmptyShards();
+    return *this;
+}
+
+/**
+* A helper function that moves an iterator at the end of a shard to the first item of the next non empty shard.
+* The end of the last shard is the end of the whole container.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::iterator::skipEmptyShards()
+{
+    while (mCurrent == mTree->mShards[mShard]->mTree.end() && mShard + 1 < mTree->mShards.size()) {
+        mShard++;
+        mCurrent = mTree->mShards[mShard]->mTree.begin();
+    }
+}
+
+/*
+	--------------------------------------------------------
+	End implementations for the ShardedTree::iterator class.
+	--------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------
+	Begin implementations for the ShardedTree class.
+	-----------------------------------------------
+*/
+
+/**
+* Constructor for an empty container that aims for the given number of shards, by default one per hardware thread.
+* It starts out with a single shard, which is split as the keys come in.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ShardedTree<Key, Value, Compare, Allocator>::ShardedTree(std::size_t shards, const Compare& compare)
+        : mTargetShards(std::max<std::size_t>(shards, 1)), mSize(0), mCompare(compare)
+{
+    mShards.emplace_back(new Shard(mCompare));
+}
+
+/**
+* Constructor for an empty shard.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+ShardedTree<Key, Value, Compare, Allocator>::Shard::Shard(const Compare& compare)
+        : mTree(compare)
+{
+
+}
+
+/**
+* Inserts a key-value pair, overwriting the value if the key is already there. Only the key's shard is locked,
+* and a shard that has grown too large afterwards is split.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::insert(const std::pair<Key, Value>& keyValuePair)
+{
+    bool skewed;
+    {
+        std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+        auto& shard = *mShards[shardOf(keyValuePair.first)];
+        std::unique_lock<std::shared_mutex> lock(shard.mLock);
+        std::size_t before = shard.mTree.size();
+        shard.mTree.insert(keyValuePair);
+        std::size_t after = shard.mTree.size();
+        mSize += after - before;
+        skewed = after != before && isSkewed(after);
+    }
+    if (skewed) {
+        splitShard(keyValuePair.first);
+    }
+}
+
+/**
+* Removes the item with the given key, if there is one. Only the key's shard is locked.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::remove(const Key& key)
+{
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    auto& shard = *mShards[shardOf(key)];
+    std::unique_lock<std::shared_mutex> lock(shard.mLock);
+    std::size_t before = shard.mTree.size();
+    shard.mTree.remove(key);
+    mSize -= before - shard.mTree.size();
+}
+
+/**
+* Looks for the given key, and copies its value into value if it is found. Readers of the same shard do not
+* block each other.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ShardedTree<Key, Value, Compare, Allocator>::find(const Key& key, Value& value) const
+{
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    auto& shard = *mShards[shardOf(key)];
+    std::shared_lock<std::shared_mutex> lock(shard.mLock);
+    auto found = shard.mTree.find(key);
+    if (found == shard.mTree.end()) {
+        return false;
+    }
+    value = found->second;
+    return true;
+}
+
+/**
+* Removes every item, clearing all of the shards in parallel. The boundaries stay where they are.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::clear()
+{
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    forEachShard(0, mShards.size(), [this](std::size_t index) {
+        auto& shard = *mShards[index];
+        std::unique_lock<std::shared_mutex> lock(shard.mLock);
+        std::size_t before = shard.mTree.size();
+        shard.mTree.clear();
+        mSize -= before;
+    });
+}
+
+/**
+* Returns the number of items in all of the shards.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t ShardedTree<Key, Value, Compare, Allocator>::size() const
+{
+    return mSize.load();
+}
+
+/**
+* Returns whether there are no items at all.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ShardedTree<Key, Value, Compare, Allocator>::empty() const
+{
+    return size() == 0;
+}
+
+/**
+* Returns the number of shards the keys are currently split across.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t ShardedTree<Key, Value, Compare, Allocator>::shardCount() const
+{
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    return mShards.size();
+}
+
+/**
+* Returns a copy of the Compare used to order the keys.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+Compare ShardedTree<Key, Value, Compare, Allocator>::key_comp() const
+{
+    return mCompare;
+}
+
+
+/**
+* Replaces the contents with a range of key value pairs, where the last pair for a key wins. The pairs are sorted
+* once and cut into equal slices, each of which becomes a shard built directly from it by a task of its own.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename InputIterator>
+void ShardedTree<Key, Value, Compare, Allocator>::assign(InputIterator first, InputIterator last)
+{
+    std::vector<std::pair<Key, Value> > items(first, last);
+    std::stable_sort(items.begin(), items.end(),
+                     [this](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) { return mCompare(a.first, b.first); });
+    std::size_t unique = 0;
+    for (std::size_t i = 0; i < items.size(); i++) {
+        if (unique != 0 && !mCompare(items[unique - 1].first, items[i].first)) {
+            items[unique - 1] = std::move(items[i]);
+        } else {
+            items[unique++] = std::move(items[i]);
+        }
+    }
+    items.erase(items.begin() + unique, items.end());
+
+    std::unique_lock<std::shared_mutex> directory(mDirectoryLock);
+    std::size_t count = std::max<std::size_t>(std::min(mTargetShards, items.size()), 1);
+    std::vector<std::unique_ptr<Shard> > shards;
+    std::vector<Key> bounds;
+    for (std::size_t i = 0; i < count; i++) {
+        shards.emplace_back(new Shard(mCompare));
+        if (i != 0) {
+            bounds.push_back(items[i * items.size() / count].first);
+        }
+    }
+    mShards.swap(shards);
+    mBounds.swap(bounds);
+    mSize = items.size();
+    forEachShard(0, count, [this, &items, count](std::size_t index) {
+        mShards[index]->mTree.assign(items.begin() + index * items.size() / count,
+                                     items.begin() + (index + 1) * items.size() / count);
+    });
+}
+
+/**
+* Inserts a batch of key value pairs, where the last pair for a key wins. The pairs are dealt out to their shards
+* and every shard applies its part with AVLTree::insertBatch() in a task of its own. If that leaves a shard skewed,
+* the whole container is rebalanced.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename InputIterator>
+void ShardedTree<Key, Value, Compare, Allocator>::insertBatch(InputIterator first, InputIterator last)
+{
+    bool skewed = false;
+    {
+        std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+        std::vector<std::vector<std::pair<Key, Value> > > parts(mShards.size());
+        for (; first != last; ++first) {
+            parts[shardOf(first->first)].push_back(*first);
+        }
+        forEachShard(0, mShards.size(), [this, &parts](std::size_t index) {
+            if (parts[index].empty()) {
+                return;
+            }
+            auto& shard = *mShards[index];
+            std::unique_lock<std::shared_mutex> lock(shard.mLock);
+            std::size_t before = shard.mTree.size();
+            shard.mTree.insertBatch(parts[index].begin(), parts[index].end());
+            mSize += shard.mTree.size() - before;
+        });
+        for (auto& shard : mShards) {
+            std::shared_lock<std::shared_mutex> lock(shard->mLock);
+            skewed = skewed || isSkewed(shard->mTree.size());
+        }
+    }
+    if (skewed) {
+        rebalance();
+    }
+}
+
+/**
+* Removes every key in a batch. The keys are dealt out to their shards and every shard applies its part with
+* AVLTree::eraseBatch() in a task of its own.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename InputIterator>
+void ShardedTree<Key, Value, Compare, Allocator>::eraseBatch(InputIterator first, InputIterator last)
+{
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    std::vector<std::vector<Key> > parts(mShards.size());
+    for (; first != last; ++first) {
+        parts[shardOf(*first)].push_back(*first);
+    }
+    forEachShard(0, mShards.size(), [this, &parts](std::size_t index) {
+        if (parts[index].empty()) {
+            return;
+        }
+        auto& shard = *mShards[index];
+        std::unique_lock<std::shared_mutex> lock(shard.mLock);
+        std::size_t before = shard.mTree.size();
+        shard.mTree.eraseBatch(parts[index].begin(), parts[index].end());
+        mSize -= before - shard.mTree.size();
+    });
+}
+
+/**
+* Calls function on every item whose key lies in [lo, hi). Every shard that overlaps the range is scanned by a
+* task of its own, in key order within the shard, so function has to be safe to call from several threads at
+* once. The shards being scanned can still be read, but not written, until the scan returns.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename Function>
+void ShardedTree<Key, Value, Compare, Allocator>::scan(const Key& lo, const Key& hi, Function function) const
+{
+    if (!mCompare(lo, hi)) {
+        return;
+    }
+    std::shared_lock<std::shared_mutex> directory(mDirectoryLock);
+    forEachShard(shardOf(lo), shardOf(hi) + 1, [this, &lo, &hi, &function](std::size_t index) {
+        auto& shard = *mShards[index];
+        std::shared_lock<std::shared_mutex> lock(shard.mLock);
+        auto end = shard.mTree.end();
+        for (auto it = shard.mTree.lower_bound(lo); it != end && mCompare(it->first, hi); ++it) {
+            const std::pair<Key, Value>& item = *it;
+            function(item);
+        }
+    });
+}
+
+/**
+* Moves the boundaries so that the keys are spread evenly over the target number of shards. The shards are
+* joined into one tree and cut apart again at evenly spaced ranks, both in O(log n) per shard, so no item is
+* copied. Everything else waits until it is done.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::rebalance()
+{
+    std::unique_lock<std::shared_mutex> directory(mDirectoryLock);
+    auto& whole = mShards[0]->mTree;
+    for (std::size_t i = 1; i < mShards.size(); i++) {
+        whole.join(mShards[i]->mTree);
+    }
+    mShards.resize(1);
+    mBounds.clear();
+
+    // Cutting from the back, so that the ranks of the keys still in the first shard do not change
+    std::size_t total = whole.size();
+    std::size_t count = std::max<std::size_t>(std::min(mTargetShards, total), 1);
+    std::vector<std::unique_ptr<Shard> > shards;
+    for (std::size_t i = count - 1; i > 0; i--) {
+        mBounds.push_back(whole.select(i * total / count)->first);
+        shards.emplace_back(new Shard(mCompare));
+        whole.split(mBounds.back(), shards.back()->mTree);
+    }
+    std::reverse(mBounds.begin(), mBounds.end());
+    for (auto it = shards.rbegin(); it != shards.rend(); ++it) {
+        mShards.push_back(std::move(*it));
+    }
+}
+
+/**
+* Returns an iterator to the smallest item of the first non empty shard.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename ShardedTree<Key, Value, Compare, Allocator>::iterator ShardedTree<Key, Value, Compare, Allocator>::begin() const
+{
+    return iterator(this, 0, mShards[0]->mTree.begin());
+}
+
+/**
+* Returns an iterator past the largest item, which is the end of the last shard.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename ShardedTree<Key, Value, Compare, Allocator>::iterator ShardedTree<Key, Value, Compare, Allocator>::end() const
+{
+    return iterator(this, mShards.size() - 1, mShards.back()->mTree.end());
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than the given key, or the end iterator if there is
+* none. Only the key's shard is searched, since the iterator moves on to the next shard by itself.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+typename ShardedTree<Key, Value, Compare, Allocator>::iterator ShardedTree<Key, Value, Compare, Allocator>::lower_bound(const Key& key) const
+{
+    std::size_t index = shardOf(key);
+    return iterator(this, index, mShards[index]->mTree.lower_bound(key));
+}
+
+/**
+* A helper function that returns the index of the shard that owns a key. The caller has to hold mDirectoryLock.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+std::size_t ShardedTree<Key, Value, Compare, Allocator>::shardOf(const Key& key) const
+{
+    return std::upper_bound(mBounds.begin(), mBounds.end(), key, mCompare) - mBounds.begin();
+}
+
+/**
+* A helper function that decides whether a shard of the given size should be split. While there are fewer shards
+* than the target any large shard is split; after that, only one with SKEW_FACTOR times as many keys as the other
+* shards have on average.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+bool ShardedTree<Key, Value, Compare, Allocator>::isSkewed(std::size_t shardSize) const
+{
+    if (shardSize <= MIN_SPLIT_SIZE) {
+        return false;
+    }
+    if (mShards.size() < mTargetShards) {
+        return true;
+    }
+    if (mShards.size() == 1) {
+        return false;
+    }
+    std::size_t others = mSize.load() - std::min(shardSize, mSize.load());
+    return shardSize > SKEW_FACTOR * others / (mShards.size() - 1);
+}
+
+/**
+* A helper function that splits the shard owning a key at its median, if it is still skewed once every other
+* operation is out of the way. When that leaves more shards than the target, two neighbours are joined.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::splitShard(const Key& key)
+{
+    std::unique_lock<std::shared_mutex> directory(mDirectoryLock);
+    std::size_t index = shardOf(key);
+    auto& tree = mShards[index]->mTree;
+    if (!isSkewed(tree.size())) {
+        return;
+    }
+    Key median = tree.select(tree.size() / 2)->first;
+    std::unique_ptr<Shard> upper(new Shard(mCompare));
+    tree.split(median, upper->mTree);
+    mShards.insert(mShards.begin() + index + 1, std::move(upper));
+    mBounds.insert(mBounds.begin() + index, median);
+    if (mShards.size() > mTargetShards) {
+        joinSmallestNeighbours(index);
+    }
+}
+
+/**
+* A helper function that joins the pair of neighbouring shards with the fewest keys between them, other than the
+* two halves of the shard that was just split. The caller has to hold mDirectoryLock exclusively.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+void ShardedTree<Key, Value, Compare, Allocator>::joinSmallestNeighbours(std::size_t splitShard)
+{
+    std::size_t best = mShards.size();
+    std::size_t bestSize = 0;
+    for (std::size_t i = 0; i + 1 < mShards.size(); i++) {
+        std::size_t pairSize = mShards[i]->mTree.size() + mShards[i + 1]->mTree.size();
+        if (i != splitShard && (best == mShards.size() || pairSize < bestSize)) {
+            best = i;
+            bestSize = pairSize;
+        }
+    }
+    if (best == mShards.size()) {
+        return;
+    }
+    mShards[best]->mTree.join(mShards[best + 1]->mTree);
+    mShards.erase(mShards.begin() + best + 1);
+    mBounds.erase(mBounds.begin() + best);
+}
+
+/**
+* A helper function that calls function with the index of every shard in [first, last), each in a task of its
+* own. The last one runs on the calling thread, and any exception is passed on once every task is done.
+*/
+template<typename Key, typename Value, typename Compare, template <typename> class Allocator>
+template<typename Function>
+void ShardedTree<Key, Value, Compare, Allocator>::forEachShard(std::size_t first, std::size_t last, Function function) const
+{
+    if (first >= last) {
+        return;
+    }
+    std::vector<std::future<void> > tasks;
+    for (std::size_t i = first; i + 1 < last; i++) {
+        tasks.push_back(std::async(std::launch::async, [&function, i]() { function(i); }));
+    }
+    function(last - 1);
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+
+/*
+	---------------------------------------------
+	End implementations for the ShardedTree class.
+	---------------------------------------------
+*/
+
+#endif // C++17
+
+#endif
@@ -0,0 +1,100 @@
+//
+// Stress test for ConcurrentAVLTree: writer threads insert, remove and find their own keys while also searching
+// everyone else's, each checking its results against a std::map of its own keys. Afterwards the tree has to hold
+// exactly the keys of all the maps, in order, and still be an AVL tree. Build from the repo root with
+//     g++ -std=c++17 -O1 -g -pthread -fsanitize=thread -I. tests/concurrentavl_stress.cpp -o concurrentavl_stress
+// (or -fsanitize=address,undefined) and run as ./concurrentavl_stress [threads] [rounds]. It exits with a non zero
+// status on the first failure.
+//
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "concurrentavl.h"
+
+typedef ConcurrentAVLTree<int, int> Tree;
+
+/**
+* Stops the test with a message if a check fails. Unlike assert, it is not compiled out by NDEBUG.
+*/
+void require(bool passed, const char* message)
+{
+    if (!passed) {
+        std::fprintf(stderr, "FAILED: %s\n", message);
+        std::exit(1);
+    }
+}
+
+/**
+* One writer's share of a round. Its keys are the ones equal to id modulo threads, so no other thread changes them
+* and model always knows what find() has to return for them. The finds of other threads' keys race with their
+* writers, so only the shape of the tree is checked for those.
+*/
+void writer(Tree& tree, std::map<int, int>& model, int id, int threads, int keys, int operations, unsigned seed)
+{
+    std::mt19937 random(seed);
+    for (int operation = 0; operation < operations; operation++) {
+        int key = static_cast<int>(random() % keys) * threads + id;
+        unsigned choice = random() % 10;
+        if (choice < 4) {
+            tree.insert(std::make_pair(key, operation));
+            model[key] = operation;
+        } else if (choice < 7) {
+            tree.remove(key);
+            model.erase(key);
+        } else {
+            int value;
+            bool found = tree.find(key, value);
+            auto expected = model.find(key);
+            require(found == (expected != model.end()), "find() disagrees with the model about a key");
+            require(!found || value == expected->second, "find() returned a stale value");
+            tree.find(static_cast<int>(random() % (keys * threads)), value);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int threads = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 4;
+    const int keys = 3000;
+    const int operations = 40000;
+
+    for (int round = 0; round < rounds; round++) {
+        Tree tree;
+        std::vector<std::map<int, int> > models(threads);
+        std::vector<std::thread> workers;
+        for (int id = 0; id < threads; id++) {
+            workers.emplace_back(writer, std::ref(tree), std::ref(models[id]), id, threads, keys, operations,
+                                 static_cast<unsigned>(round * 7919 + id));
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        // Every thread's keys end up in one sorted run, so merge the models and walk both in order
+        std::map<int, int> expected;
+        for (const std::map<int, int>& model : models) {
+            expected.insert(model.begin(), model.end());
+        }
+        require(tree.isBalanced(), "the tree is no longer balanced");
+        auto next = expected.begin();
+        bool first = true;
+        int previous = 0;
+        for (auto it = tree.begin(); it != tree.end(); ++it) {
+            require(first || previous < it->first, "the keys are out of order");
+            require(next != expected.end(), "the tree holds a key that was removed");
+            require(it->first == next->first && it->second == next->second, "the tree and the models differ");
+            previous = it->first;
+            first = false;
+            ++next;
+        }
+        require(next == expected.end(), "the tree lost a key");
+        std::printf("round %d: %d threads, %zu keys ok\n", round, threads, expected.size());
+    }
+    return 0;
+}
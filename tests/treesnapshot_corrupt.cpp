@@ -0,0 +1,175 @@
+//
+// Test that AVLTree::load() and MappedSnapshot turn down snapshot files that are corrupt, cut short or hostile
+// with an exception, and leave the tree they were loading into as it was. Build from the repo root with
+//     g++ -std=c++17 -O1 -g -fsanitize=address,undefined -I. tests/treesnapshot_corrupt.cpp -o treesnapshot_corrupt
+// and run as ./treesnapshot_corrupt [directory], where the scratch files go in directory (/tmp by default). It exits
+// with a non zero status on the first failure.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include "avlbst.h"
+
+/**
+* Stops the test with a message if a check fails. Unlike assert, it is not compiled out by NDEBUG.
+*/
+void require(bool passed, const char* message)
+{
+    if (!passed) {
+        std::fprintf(stderr, "FAILED: %s\n", message);
+        std::exit(1);
+    }
+}
+
+/**
+* Returns the whole contents of a file.
+*/
+std::string readFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+/**
+* Replaces the contents of a file.
+*/
+void writeFile(const std::string& path, const std::string& data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+/**
+* Reads the header at the start of a snapshot's bytes.
+*/
+SnapshotHeader headerOf(const std::string& data)
+{
+    SnapshotHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    return header;
+}
+
+/**
+* Writes a header back over the start of a snapshot's bytes.
+*/
+void setHeader(std::string& data, const SnapshotHeader& header)
+{
+    std::memcpy(&data[0], &header, sizeof(header));
+}
+
+/**
+* Checks that loading the file into tree throws a std::runtime_error and leaves tree with the one item it started
+* with.
+*/
+template <typename Tree>
+void requireRejected(const std::string& path, Tree& tree, const char* message)
+{
+    bool rejected = false;
+    try {
+        tree.load(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    require(rejected, message);
+    require(tree.begin() != tree.end() && ++tree.begin() == tree.end(), "a failed load changed the tree");
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string path = std::string(argc > 1 ? argv[1] : "/tmp") + "/treesnapshot_corrupt.snap";
+
+    AVLTree<int, int> numbers;
+    for (int i = 0; i < 1000; i++) {
+        numbers.insert(std::make_pair(i, i * 2));
+    }
+    AVLTree<std::string, std::string> strings;
+    for (int i = 0; i < 1000; i++) {
+        strings.insert(std::make_pair(std::to_string(i), std::string(i % 50, 'x')));
+    }
+    AVLTree<int, int> target;
+    target.insert(std::make_pair(-1, -1));
+    AVLTree<std::string, std::string> stringTarget;
+    stringTarget.insert(std::make_pair("-1", "-1"));
+
+    numbers.save(path);
+    const std::string valid = readFile(path);
+    strings.save(path);
+    const std::string validStrings = readFile(path);
+
+    // A file too short for a header, and one that is not a snapshot at all
+    writeFile(path, "hello");
+    requireRejected(path, target, "a file shorter than a header was accepted");
+    std::string notSnapshot = valid;
+    notSnapshot[0] = 'X';
+    writeFile(path, notSnapshot);
+    requireRejected(path, target, "a file without the magic was accepted");
+
+    // Cut short, both with the header's file size left alone and with it patched to match
+    writeFile(path, valid.substr(0, valid.size() / 2));
+    requireRejected(path, target, "a truncated file was accepted");
+    std::string cut = validStrings.substr(0, validStrings.size() - 3);
+    SnapshotHeader header = headerOf(cut);
+    header.mFileSize = cut.size();
+    setHeader(cut, header);
+    writeFile(path, cut);
+    requireRejected(path, stringTarget, "a string snapshot with a record cut short was accepted");
+
+    // Read with the wrong types or codecs
+    writeFile(path, validStrings);
+    requireRejected(path, target, "a string snapshot was loaded as ints");
+    writeFile(path, valid);
+    requireRejected(path, stringTarget, "an int snapshot was loaded as strings");
+
+    // Counts so large that count * sizeof(Key) wraps around to something small
+    const std::uint64_t hostileCounts[] = {1ull << 62, 1ull << 63, ~0ull / 4 + 1, ~0ull};
+    for (std::uint64_t count : hostileCounts) {
+        std::string hostile = valid;
+        header = headerOf(hostile);
+        header.mCount = count;
+        setHeader(hostile, header);
+        writeFile(path, hostile);
+        requireRejected(path, target, "a fixed size snapshot with a wrapping count was accepted");
+        bool rejected = false;
+        try {
+            MappedSnapshot<int, int> mapped(path);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        require(rejected, "MappedSnapshot accepted a wrapping count");
+
+        hostile = validStrings;
+        header = headerOf(hostile);
+        header.mCount = count;
+        setHeader(hostile, header);
+        writeFile(path, hostile);
+        requireRejected(path, stringTarget, "a record snapshot with a huge count was accepted");
+    }
+
+    // One more item than the arrays hold, and offsets past the end of the file
+    std::string tooMany = valid;
+    header = headerOf(tooMany);
+    header.mCount++;
+    setHeader(tooMany, header);
+    writeFile(path, tooMany);
+    requireRejected(path, target, "a count one past the arrays was accepted");
+    std::string farOffset = valid;
+    header = headerOf(farOffset);
+    header.mValuesOffset = ~0ull - (~0ull % SnapshotHeader::ALIGNMENT);
+    setHeader(farOffset, header);
+    writeFile(path, farOffset);
+    requireRejected(path, target, "an offset past the end of the file was accepted");
+
+    // The untouched files still load
+    writeFile(path, valid);
+    target.load(path);
+    require(target.begin()->first == 0 && target.find(999)->second == 1998, "a valid snapshot did not load");
+
+    std::remove(path.c_str());
+    std::printf("ok\n");
+    return 0;
+}
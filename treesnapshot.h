@@ -0,0 +1,716 @@
+//
+// Binary snapshot files of a tree's items, written in key order and read back through a memory mapping.
+//
+
+#ifndef TREESNAPSHOT_H
+#define TREESNAPSHOT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+* Turns keys and values into bytes for a snapshot and back. This version stores a trivially copyable type as its
+* raw bytes, which is what lets a snapshot be searched in place (FIXED_SIZE). Any other type needs a codec of its
+* own, either as a specialization of SnapshotCodec or as a class with the same three members passed to save() and
+* load(). decode() reads from next, moves it past what it read, and throws if that would go past end. A key and its
+* value have to take at least one byte between them.
+*/
+template <typename T>
+struct SnapshotCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be stored as raw bytes, others need a SnapshotCodec");
+
+    static const bool FIXED_SIZE = true;
+
+    static void encode(const T& value, std::string& out);
+    static T decode(const char*& next, const char* end);
+};
+
+/**
+* A codec for strings, which stores the length followed by the characters.
+*/
+template <>
+struct SnapshotCodec<std::string>
+{
+    static const bool FIXED_SIZE = false;
+
+    static void encode(const std::string& value, std::string& out);
+    static std::string decode(const char*& next, const char* end);
+};
+
+/**
+* The start of every snapshot file. A snapshot whose keys and values both have FIXED_SIZE codecs keeps them in two
+* arrays, each aligned to a cache line, and any other snapshot is a run of encoded key value records. Numbers are in
+* the byte order of the machine that wrote the file, which mByteOrder catches.
+*/
+struct SnapshotHeader
+{
+    char mMagic[8];
+    std::uint32_t mVersion;
+    std::uint32_t mByteOrder;
+    std::uint32_t mFlags;
+    std::uint32_t mKeySize;
+    std::uint32_t mValueSize;
+    std::uint32_t mReserved;
+    std::uint64_t mCount;
+    std::uint64_t mKeysOffset;
+    std::uint64_t mValuesOffset;
+    std::uint64_t mFileSize;
+
+    static const std::uint32_t VERSION = 1;
+    static const std::uint32_t BYTE_ORDER_MARK = 0x01020304u;
+    static const std::uint32_t FIXED_SIZE = 1;
+    static const std::uint64_t ALIGNMENT = 64;
+};
+
+/**
+* Writes a snapshot to a temporary file next to its final path, through a large buffer. Nothing shows up under the
+* final path until commit(), which syncs the file and renames it into place, so a crash never leaves half a
+* snapshot behind. A writer that is destroyed without a commit() removes the temporary file.
+*/
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(const std::string& path);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter& other) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter& other) = delete;
+
+    void append(const void* data, std::size_t size);
+    void alignTo(std::uint64_t alignment);
+    std::uint64_t offset() const;
+    void commit(SnapshotHeader& header);
+
+private:
+    void flush();
+
+    static const std::size_t BUFFER_SIZE = 1 << 20;
+
+    std::string mPath;
+    std::string mTempPath;
+    int mFile;
+    std::uint64_t mOffset;
+    std::string mBuffer;
+};
+
+/**
+* A whole file mapped read only into memory, unmapped again when the SnapshotFile goes away.
+*/
+class SnapshotFile
+{
+public:
+    explicit SnapshotFile(const std::string& path);
+    SnapshotFile(SnapshotFile&& other) noexcept;
+    ~SnapshotFile();
+    SnapshotFile(const SnapshotFile& other) = delete;
+    SnapshotFile& operator=(const SnapshotFile& other) = delete;
+
+    const char* data() const;
+    std::size_t size() const;
+
+private:
+    const char* mData;
+    std::size_t mSize;
+};
+
+/**
+* A snapshot file mapped into memory. Its items can be walked in key order, for example to build a tree from them
+* with AVLTree::load(). If both codecs are FIXED_SIZE, find() and lower_bound() also binary search the mapped arrays
+* directly, so a read only service can answer lookups without building anything; only the pages a search touches
+* are ever read from disk.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename KeyCodec = SnapshotCodec<Key>, typename ValueCodec = SnapshotCodec<Value> >
+class MappedSnapshot
+{
+public:
+    static const bool FIXED_SIZE = KeyCodec::FIXED_SIZE && ValueCodec::FIXED_SIZE;
+
+    explicit MappedSnapshot(const std::string& path, const Compare& compare = Compare());
+
+    /**
+    * An iterator that decodes the items of a snapshot one at a time, in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::pair<Key, Value>* pointer;
+        typedef const std::pair<Key, Value>& reference;
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        iterator(const MappedSnapshot* snapshot, std::size_t index, const char* next);
+        void decode();
+
+        const MappedSnapshot* mSnapshot;
+        std::size_t mIndex;
+        const char* mNext;
+        std::pair<Key, Value> mItem;
+
+        friend class MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>;
+    };
+
+    std::size_t size() const;
+    bool empty() const;
+    iterator begin() const;
+    iterator end() const;
+    const Value* find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+
+private:
+    std::size_t lowerBoundIndex(const Key& key) const;
+    void corrupt(const char* reason) const;
+
+    std::string mPath;
+    SnapshotFile mFile;
+    SnapshotHeader mHeader;
+    const Key* mKeys;
+    const Value* mValues;
+    Compare mCompare;
+};
+
+template <typename KeyCodec, typename ValueCodec, typename ForwardIterator>
+void saveSnapshot(const std::string& path, ForwardIterator first, ForwardIterator last);
+
+/*
+	-------------------------------------------------
+	Begin implementations for the SnapshotCodec class.
+	-------------------------------------------------
+*/
+
+/**
+* Appends the raw bytes of a value.
+*/
+template<typename T>
+void SnapshotCodec<T>::encode(const T& value, std::string& out)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+* Reads a value back from its raw bytes, which need not be aligned.
+*/
+template<typename T>
+T SnapshotCodec<T>::decode(const char*& next, const char* end)
+{
+    if (static_cast<std::size_t>(end - next) < sizeof(T)) {
+        throw std::runtime_error("Snapshot record is cut short");
+    }
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    std::memcpy(&storage, next, sizeof(T));
+    next += sizeof(T);
+    return *reinterpret_cast<T*>(&storage);
+}
+
+/**
+* Appends the length of a string and then its characters.
+*/
+inline void SnapshotCodec<std::string>::encode(const std::string& value, std::string& out)
+{
+    std::uint64_t length = value.size();
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.append(value);
+}
+
+/**
+* Reads a string back from its length and characters.
+*/
+inline std::string SnapshotCodec<std::string>::decode(const char*& next, const char* end)
+{
+    std::uint64_t length = SnapshotCodec<std::uint64_t>::decode(next, end);
+    if (static_cast<std::uint64_t>(end - next) < length) {
+        throw std::runtime_error("Snapshot record is cut short");
+    }
+    std::string value(next, length);
+    next += length;
+    return value;
+}
+
+/*
+	-----------------------------------------------
+	End implementations for the SnapshotCodec class.
+	-----------------------------------------------
+*/
+
+/*
+	--------------------------------------------------
+	Begin implementations for the SnapshotWriter class.
+	--------------------------------------------------
+*/
+
+/**
+* Constructor that creates the temporary file and leaves room for the header at its start.
+*/
+inline SnapshotWriter::SnapshotWriter(const std::string& path)
+        : mPath(path), mTempPath(path + ".tmp"), mOffset(0)
+{
+    mFile = ::open(mTempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (mFile < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create " + mTempPath);
+    }
+    mBuffer.reserve(BUFFER_SIZE);
+    SnapshotHeader empty;
+    std::memset(&empty, 0, sizeof(empty));
+    append(&empty, sizeof(empty));
+}
+
+/**
+* Deconstructor, which throws away the temporary file if the snapshot was never committed.
+*/
+inline SnapshotWriter::~SnapshotWriter()
+{
+    if (mFile >= 0) {
+        ::close(mFile);
+        ::unlink(mTempPath.c_str());
+    }
+}
+
+/**
+* Adds bytes to the end of the file.
+*/
+inline void SnapshotWriter::append(const void* data, std::size_t size)
+{
+    mBuffer.append(static_cast<const char*>(data), size);
+    mOffset += size;
+    if (mBuffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+/**
+* Pads the file with zeros up to the next multiple of alignment.
+*/
+inline void SnapshotWriter::alignTo(std::uint64_t alignment)
+{
+    std::uint64_t padding = (alignment - mOffset % alignment) % alignment;
+    mBuffer.append(padding, '\0');
+    mOffset += padding;
+}
+
+/**
+* Returns the size of the file so far, which is where the next append() lands.
+*/
+inline std::uint64_t SnapshotWriter::offset() const
+{
+    return mOffset;
+}
+
+/**
+* Fills in the header's identity and size, writes it at the start of the file, and makes the file durable under
+* its final path.
+*/
+inline void SnapshotWriter::commit(SnapshotHeader& header)
+{
+    std::memcpy(header.mMagic, "AVLSNAP", 8);
+    header.mVersion = SnapshotHeader::VERSION;
+    header.mByteOrder = SnapshotHeader::BYTE_ORDER_MARK;
+    header.mReserved = 0;
+    header.mFileSize = mOffset;
+    flush();
+    if (::pwrite(mFile, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            ::fsync(mFile) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot write " + mTempPath);
+    }
+    int result = ::close(mFile);
+    mFile = -1;
+    if (result != 0 || ::rename(mTempPath.c_str(), mPath.c_str()) != 0) {
+        int error = errno;
+        ::unlink(mTempPath.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot save " + mPath);
+    }
+}
+
+/**
+* A helper function that writes out the buffer, however many calls that takes.
+*/
+inline void SnapshotWriter::flush()
+{
+    const char* next = mBuffer.data();
+    std::size_t left = mBuffer.size();
+    while (left > 0) {
+        ssize_t written = ::write(mFile, next, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Cannot write " + mTempPath);
+        }
+        next += written;
+        left -= written;
+    }
+    mBuffer.clear();
+}
+
+/*
+	------------------------------------------------
+	End implementations for the SnapshotWriter class.
+	------------------------------------------------
+*/
+
+/*
+	------------------------------------------------
+	Begin implementations for the SnapshotFile class.
+	------------------------------------------------
+*/
+
+/**
+* Constructor that maps the whole file. The descriptor is not needed once the mapping exists.
+*/
+inline SnapshotFile::SnapshotFile(const std::string& path)
+        : mData(NULL), mSize(0)
+{
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+    }
+    struct stat status;
+    if (::fstat(file, &status) != 0) {
+        int error = errno;
+        ::close(file);
+        throw std::system_error(error, std::generic_category(), "Cannot read " + path);
+    }
+    mSize = status.st_size;
+    if (mSize > 0) {
+        void* data = ::mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            ::close(file);
+            throw std::system_error(error, std::generic_category(), "Cannot map " + path);
+        }
+        mData = static_cast<const char*>(data);
+    }
+    ::close(file);
+}
+
+/**
+* Move constructor, which takes over the other file's mapping.
+*/
+inline SnapshotFile::SnapshotFile(SnapshotFile&& other) noexcept
+        : mData(other.mData), mSize(other.mSize)
+{
+    other.mData = NULL;
+    other.mSize = 0;
+}
+
+/**
+* Deconstructor, which unmaps the file.
+*/
+inline SnapshotFile::~SnapshotFile()
+{
+    if (mData != NULL) {
+        ::munmap(const_cast<char*>(mData), mSize);
+    }
+}
+
+/**
+* Returns the first byte of the mapped file.
+*/
+inline const char* SnapshotFile::data() const
+{
+    return mData;
+}
+
+/**
+* Returns the size of the mapped file in bytes.
+*/
+inline std::size_t SnapshotFile::size() const
+{
+    return mSize;
+}
+
+/*
+	----------------------------------------------
+	End implementations for the SnapshotFile class.
+	----------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------------
+	Begin implementations for the MappedSnapshot::iterator class.
+	-----------------------------------------------------------
+*/
+
+/**
+* Constructor for an iterator at the given item, which is decoded right away.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::iterator(const MappedSnapshot* snapshot,
+                                                                              std::size_t index, const char* next)
+        : mSnapshot(snapshot), mIndex(index), mNext(next)
+{
+    decode();
+}
+
+/**
+* Dereferences the iterator.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+const std::pair<Key, Value>& MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::operator*() const
+{
+    return mItem;
+}
+
+/**
+* Dereferences the iterator.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+const std::pair<Key, Value>* MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::operator->() const
+{
+    return &mItem;
+}
+
+/**
+* Checks if 'this' iterator is at the same item as 'rhs'.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+bool MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::operator==(const iterator& rhs) const
+{
+    return mIndex == rhs.mIndex;
+}
+
+/**
+* Checks if 'this' iterator is at a different item than 'rhs'.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+bool MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::operator!=(const iterator& rhs) const
+{
+    return mIndex != rhs.mIndex;
+}
+
+/**
+* Moves on to the next item and decodes it.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+typename MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator& MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::operator++()
+{
+    mIndex++;
+    decode();
+    return *this;
+}
+
+/**
+* A helper function that reads the current item, either straight from the arrays or from the next record.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+void MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator::decode()
+{
+    if (mIndex >= mSnapshot->size()) {
+        return;
+    }
+    if (FIXED_SIZE) {
+        mItem.first = mSnapshot->mKeys[mIndex];
+        mItem.second = mSnapshot->mValues[mIndex];
+    } else {
+        const char* end = mSnapshot->mFile.data() + mSnapshot->mFile.size();
+        mItem.first = KeyCodec::decode(mNext, end);
+        mItem.second = ValueCodec::decode(mNext, end);
+    }
+}
+
+/*
+	---------------------------------------------------------
+	End implementations for the MappedSnapshot::iterator class.
+	---------------------------------------------------------
+*/
+
+/*
+	--------------------------------------------------
+	Begin implementations for the MappedSnapshot class.
+	--------------------------------------------------
+*/
+
+/**
+* Constructor that maps a snapshot file and checks that its header matches the file and the Key, Value and codecs
+* it is being read with.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::MappedSnapshot(const std::string& path, const Compare& compare)
+        : mPath(path), mFile(path), mKeys(NULL), mValues(NULL), mCompare(compare)
+{
+    if (mFile.size() < sizeof(SnapshotHeader)) {
+        corrupt("too short for a header");
+    }
+    std::memcpy(&mHeader, mFile.data(), sizeof(mHeader));
+    if (std::memcmp(mHeader.mMagic, "AVLSNAP", 8) != 0) {
+        corrupt("not a snapshot");
+    }
+    if (mHeader.mVersion != SnapshotHeader::VERSION || mHeader.mByteOrder != SnapshotHeader::BYTE_ORDER_MARK) {
+        corrupt("written by an incompatible version or machine");
+    }
+    if (mHeader.mFileSize != mFile.size()) {
+        corrupt("cut short");
+    }
+    if (((mHeader.mFlags & SnapshotHeader::FIXED_SIZE) != 0) != FIXED_SIZE) {
+        corrupt("written with different codecs");
+    }
+
+    if (FIXED_SIZE) {
+        if (mHeader.mKeySize != sizeof(Key) || mHeader.mValueSize != sizeof(Value)) {
+            corrupt("written with different key or value types");
+        }
+        // Checked by dividing the space left, since a hostile count can make count * size wrap around
+        if (mHeader.mKeysOffset % SnapshotHeader::ALIGNMENT != 0 || mHeader.mValuesOffset % SnapshotHeader::ALIGNMENT != 0 ||
+                mHeader.mKeysOffset > mFile.size() || mHeader.mValuesOffset > mFile.size() ||
+                mHeader.mCount > (mFile.size() - mHeader.mKeysOffset) / sizeof(Key) ||
+                mHeader.mCount > (mFile.size() - mHeader.mValuesOffset) / sizeof(Value)) {
+            corrupt("arrays out of bounds");
+        }
+        mKeys = reinterpret_cast<const Key*>(mFile.data() + mHeader.mKeysOffset);
+        mValues = reinterpret_cast<const Value*>(mFile.data() + mHeader.mValuesOffset);
+    } else if (mHeader.mKeysOffset > mFile.size() || mHeader.mCount > mFile.size() - mHeader.mKeysOffset) {
+        // Every record takes at least a byte, so there cannot be more of them than bytes left
+        corrupt("records out of bounds");
+    }
+}
+
+/**
+* Returns the number of items in the snapshot.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+std::size_t MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::size() const
+{
+    return mHeader.mCount;
+}
+
+/**
+* Returns whether the snapshot has no items.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+bool MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::empty() const
+{
+    return size() == 0;
+}
+
+/**
+* Returns an iterator to the item with the smallest key.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+typename MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::begin() const
+{
+    return iterator(this, 0, mFile.data() + mHeader.mKeysOffset);
+}
+
+/**
+* Returns an iterator past the item with the largest key.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+typename MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::end() const
+{
+    return iterator(this, size(), NULL);
+}
+
+/**
+* Returns a pointer to the value for the given key inside the mapped file, or NULL if the key is not there. Only
+* for snapshots of fixed size items.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+const Value* MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::find(const Key& key) const
+{
+    std::size_t index = lowerBoundIndex(key);
+    if (index == size() || mCompare(key, mKeys[index])) {
+        return NULL;
+    }
+    return &mValues[index];
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than the given key. Only for snapshots of fixed size
+* items.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+typename MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::iterator MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::lower_bound(const Key& key) const
+{
+    return iterator(this, lowerBoundIndex(key), NULL);
+}
+
+/**
+* A helper function that binary searches the mapped key array.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+std::size_t MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::lowerBoundIndex(const Key& key) const
+{
+    static_assert(FIXED_SIZE, "Only snapshots of fixed size keys and values can be searched in place");
+    return std::lower_bound(mKeys, mKeys + size(), key, mCompare) - mKeys;
+}
+
+/**
+* A helper function that reports a file that cannot be read as a snapshot.
+*/
+template<typename Key, typename Value, typename Compare, typename KeyCodec, typename ValueCodec>
+void MappedSnapshot<Key, Value, Compare, KeyCodec, ValueCodec>::corrupt(const char* reason) const
+{
+    throw std::runtime_error("Bad snapshot " + mPath + ": " + reason);
+}
+
+/*
+	------------------------------------------------
+	End implementations for the MappedSnapshot class.
+	------------------------------------------------
+*/
+
+/**
+* Writes the items in [first, last), which have to be in key order, to a snapshot file at path. Fixed size keys and
+* values go into two cache line aligned arrays, written in two passes over the range, and anything else is written
+* in one pass as records. The file replaces any old one at path only once it is complete and synced.
+*/
+template <typename KeyCodec, typename ValueCodec, typename ForwardIterator>
+void saveSnapshot(const std::string& path, ForwardIterator first, ForwardIterator last)
+{
+    SnapshotWriter writer(path);
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::string record;
+
+    if (KeyCodec::FIXED_SIZE && ValueCodec::FIXED_SIZE) {
+        header.mFlags = SnapshotHeader::FIXED_SIZE;
+        header.mKeySize = sizeof(first->first);
+        header.mValueSize = sizeof(first->second);
+        writer.alignTo(SnapshotHeader::ALIGNMENT);
+        header.mKeysOffset = writer.offset();
+        for (ForwardIterator it = first; it != last; ++it) {
+            writer.append(&it->first, sizeof(it->first));
+            header.mCount++;
+        }
+        writer.alignTo(SnapshotHeader::ALIGNMENT);
+        header.mValuesOffset = writer.offset();
+        for (ForwardIterator it = first; it != last; ++it) {
+            writer.append(&it->second, sizeof(it->second));
+        }
+    } else {
+        header.mKeysOffset = writer.offset();
+        for (ForwardIterator it = first; it != last; ++it) {
+            record.clear();
+            KeyCodec::encode(it->first, record);
+            ValueCodec::encode(it->second, record);
+            writer.append(record.data(), record.size());
+            header.mCount++;
+        }
+    }
+    writer.commit(header);
+}
+
+#endif